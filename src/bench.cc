@@ -0,0 +1,428 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#include "symbol_map_t.h"
+#include "symbolize.h"
+#include "utils.h"
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fmt/os.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+namespace chrono = std::chrono;
+
+//
+// The various commad line options that the benchmark supports.
+//
+
+struct BenchOpts_t {
+
+  //
+  // The trace sizes (in lines) to benchmark.
+  //
+
+  std::vector<uint64_t> Lines = {1'000'000, 10'000'000};
+
+  //
+  // The ratios of unique addresses per line to benchmark.
+  //
+
+  std::vector<double> UniqueRatios = {0.001, 0.01, 0.1};
+
+  //
+  // The number of times every measurement is repeated.
+  //
+
+  uint32_t Repeat = 0;
+
+  //
+  // The seed used to generate the synthetic traces and symbols.
+  //
+
+  uint64_t Seed = 0;
+
+  //
+  // Where the JSON results are written; stdout if empty.
+  //
+
+  fs::path Json;
+};
+
+//
+// The result of a measurement.
+//
+
+struct Result_t {
+  std::string Stage;
+  uint64_t Lines = 0;
+  uint64_t Unique = 0;
+  uint64_t Bytes = 0;
+  uint64_t Items = 0;
+  uint64_t BestNs = 0;
+  uint64_t MeanNs = 0;
+};
+
+//
+// The synthetic workload: a symbol table, the unique addresses a trace is
+// built from and the trace itself.
+//
+
+struct Workload_t {
+  SymbolMap_t Symbols;
+  std::vector<uint64_t> Unique;
+  std::string Trace;
+};
+
+BenchOpts_t Opts;
+
+//
+// Build a symbol table with a bunch of modules made of functions of random
+// sizes.
+//
+
+void BuildSymbols(std::mt19937_64 &Rng, SymbolMap_t &Symbols,
+                  std::vector<uint64_t> &Functions) {
+  constexpr uint64_t NumberModules = 32;
+  constexpr uint64_t NumberFunctions = 4'096;
+  uint64_t Base = 0xfffff80000000000;
+  for (uint64_t ModuleIdx = 0; ModuleIdx < NumberModules; ModuleIdx++) {
+    const std::string Module = fmt::format("mod{}", ModuleIdx);
+    uint64_t Address = Base + 0x1000;
+    for (uint64_t FunctionIdx = 0; FunctionIdx < NumberFunctions;
+         FunctionIdx++) {
+      Symbols.AddSymbol(fmt::format("Function{}", FunctionIdx), Address);
+      Functions.emplace_back(Address);
+      Address += 0x10 + (Rng() % 0x800);
+    }
+
+    const uint64_t Size = (Address - Base + 0xfff) & ~uint64_t(0xfff);
+    Symbols.AddModule(Module, Base, Size);
+    Base += Size + 0x10'000;
+  }
+}
+
+//
+// Build a trace of |Lines| lines made of |Unique| distinct addresses. The
+// addresses are picked as runs of instructions inside functions, and the
+// trace hops from one run to another.
+//
+
+Workload_t BuildWorkload(const uint64_t Lines, const uint64_t Unique) {
+  std::mt19937_64 Rng(Opts.Seed);
+  Workload_t Workload;
+  std::vector<uint64_t> Functions;
+  BuildSymbols(Rng, Workload.Symbols, Functions);
+
+  while (Workload.Unique.size() < Unique) {
+    const uint64_t Function = Functions[Rng() % Functions.size()];
+    const uint64_t RunLength = 1 + (Rng() % 16);
+    for (uint64_t Idx = 0;
+         Idx < RunLength && Workload.Unique.size() < Unique; Idx++) {
+      Workload.Unique.emplace_back(Function + (Idx * 4));
+    }
+  }
+
+  fmt::memory_buffer Trace;
+  uint64_t Emitted = 0;
+  while (Emitted < Lines) {
+    const uint64_t Start = Rng() % Workload.Unique.size();
+    const uint64_t RunLength = 1 + (Rng() % 32);
+    for (uint64_t Idx = 0; Idx < RunLength && Emitted < Lines;
+         Idx++, Emitted++) {
+      const uint64_t Address =
+          Workload.Unique[(Start + Idx) % Workload.Unique.size()];
+      fmt::format_to(std::back_inserter(Trace), "{:#x}\n", Address);
+    }
+  }
+
+  Workload.Trace = fmt::to_string(Trace);
+  return Workload;
+}
+
+//
+// Run |Callback| |Opts.Repeat| times and return the best and mean timings.
+// |Setup| is invoked before every run and is not measured.
+//
+
+template <typename S_t, typename F_t>
+std::pair<uint64_t, uint64_t> Measure(const S_t &Setup, const F_t &Callback) {
+  uint64_t Best = UINT64_MAX;
+  uint64_t Total = 0;
+  for (uint32_t Run = 0; Run < Opts.Repeat; Run++) {
+    Setup();
+    const auto &Before = chrono::steady_clock::now();
+    Callback();
+    const auto &Elapsed = chrono::steady_clock::now() - Before;
+    const uint64_t Ns =
+        chrono::duration_cast<chrono::nanoseconds>(Elapsed).count();
+    Best = std::min(Best, Ns);
+    Total += Ns;
+  }
+
+  return {Best, Total / Opts.Repeat};
+}
+
+//
+// Benchmark every stage of the symbolization, separately and together, on a
+// trace of |Lines| lines with |Unique| distinct addresses.
+//
+
+void BenchWorkload(const uint64_t Lines, const uint64_t Unique,
+                   const fs::path &OutputPath, std::vector<Result_t> &Results) {
+  Workload_t Workload = BuildWorkload(Lines, Unique);
+  const char *Begin = Workload.Trace.data();
+  const char *End = Begin + Workload.Trace.size();
+  const auto NoSetup = [] {};
+
+  Opts_t SymbolizeOpts;
+  SymbolizeOpts.Style = TraceStyle_t::FullSymbol;
+  const auto &Record = [&](const char *Stage, const uint64_t Items,
+                           const std::pair<uint64_t, uint64_t> &Timings) {
+    Results.emplace_back(Result_t{Stage, Lines, Unique, Workload.Trace.size(),
+                                  Items, Timings.first, Timings.second});
+  };
+
+  //
+  // Parsing the trace into addresses.
+  //
+
+  std::vector<uint64_t> Addresses;
+  Addresses.reserve(Lines);
+  Record("parse", Lines, Measure([&] { Addresses.clear(); }, [&] {
+           ForEachTraceLine(SymbolizeOpts, Begin, End,
+                            [&](const uint64_t, const uint64_t Address,
+                                const std::string_view &) {
+                              Addresses.emplace_back(Address);
+                              return true;
+                            });
+         }));
+
+  //
+  // Resolving the addresses missing from the cache.
+  //
+
+  std::vector<std::string> Resolved;
+  Resolved.reserve(Workload.Unique.size());
+  Record("resolve", Unique, Measure([&] { Resolved.clear(); }, [&] {
+           for (const uint64_t Address : Workload.Unique) {
+             Resolved.emplace_back(
+                 *Workload.Symbols.Resolve(Address, SymbolizeOpts.Style));
+           }
+         }));
+
+  //
+  // Looking up the addresses in a warm cache.
+  //
+
+  SymbolCache_t Cache;
+  for (size_t Idx = 0; Idx < Workload.Unique.size(); Idx++) {
+    Cache.Symbolize(Workload.Unique[Idx], [&](const uint64_t) {
+      return std::optional<std::string>(Resolved[Idx]);
+    });
+  }
+
+  std::vector<const std::string *> Symbolized;
+  Symbolized.reserve(Lines);
+  Record("lookup", Lines, Measure([&] { Symbolized.clear(); }, [&] {
+           for (const uint64_t Address : Addresses) {
+             Symbolized.emplace_back(&Cache.Find(Address)->get());
+           }
+         }));
+
+  //
+  // Formatting the output lines.
+  //
+
+  uint64_t Formatted = 0;
+  Record("format", Lines, Measure([&] { Formatted = 0; }, [&] {
+           fmt::memory_buffer Buffer;
+           for (size_t Idx = 0; Idx < Symbolized.size(); Idx++) {
+             fmt::format_to(std::back_inserter(Buffer), "l{}: {}\n", Idx,
+                            *Symbolized[Idx]);
+             if (Buffer.size() >= 1'024 * 1'024) {
+               Formatted += Buffer.size();
+               Buffer.clear();
+             }
+           }
+           Formatted += Buffer.size();
+         }));
+
+  //
+  // Writing the output lines into the output trace.
+  //
+
+  Record("output", Lines, Measure(NoSetup, [&] {
+           OutputSink_t Out(OutputPath);
+           for (const std::string *Symbol : Symbolized) {
+             Out.Print("{}\n", *Symbol);
+           }
+         }));
+
+  //
+  // And all of the above together, starting with a cold cache.
+  //
+
+  Stats_t Stats;
+  const auto &ColdCache = [&] { Workload.Symbols.ClearCache(); };
+  Record("end-to-end", Lines, Measure(ColdCache, [&] {
+           OutputSink_t Out(OutputPath);
+           SymbolizeBuffer(Workload.Symbols, SymbolizeOpts, "bench", Begin,
+                           End, Out, Stats);
+         }));
+
+  //
+  // The same for the other variants of the symbolization loop: the other
+  // trace style, the line numbers, the other input formats and the output
+  // formats (which should be as fast as the built-in styles they match).
+  //
+
+  std::string Raw64;
+  std::string Compact;
+  std::string Tenet;
+  std::string Perf;
+  uint64_t Previous = 0;
+  for (const uint64_t Address : Addresses) {
+    Raw64.append((const char *)&Address, sizeof(Address));
+    AppendCompact(Compact, Previous, Address);
+    AppendTenet(Tenet, Previous, Address);
+    fmt::format_to(std::back_inserter(Perf),
+                   "bench 1337 [000] 1.000000: 1 cycles:u: {:16x} "
+                   "[unknown] (bench)\n",
+                   Address);
+    Previous = Address;
+  }
+
+  struct Variant_t {
+    const char *Stage;
+    TraceStyle_t Style;
+    bool LineNumbers;
+    TraceFormat_t Format;
+    const std::string &Trace;
+    const char *OutputFormat = nullptr;
+  };
+
+  const Variant_t Variants[] = {
+      {"end-to-end-modoff", TraceStyle_t::Modoff, false, TraceFormat_t::Hex,
+       Workload.Trace},
+      {"end-to-end-line-numbers", TraceStyle_t::FullSymbol, true,
+       TraceFormat_t::Hex, Workload.Trace},
+      {"end-to-end-raw64", TraceStyle_t::FullSymbol, false,
+       TraceFormat_t::Raw64, Raw64},
+      {"end-to-end-compact", TraceStyle_t::FullSymbol, false,
+       TraceFormat_t::Compact, Compact},
+      {"end-to-end-tenet", TraceStyle_t::FullSymbol, false,
+       TraceFormat_t::Tenet, Tenet},
+      {"end-to-end-perf", TraceStyle_t::FullSymbol, false,
+       TraceFormat_t::Perf, Perf},
+      {"end-to-end-format", TraceStyle_t::Custom, false, TraceFormat_t::Hex,
+       Workload.Trace, "{mod}!{sym}+0x{disp:x}"},
+      {"end-to-end-format-line-numbers", TraceStyle_t::Custom, false,
+       TraceFormat_t::Hex, Workload.Trace, "l{line}: {mod}!{sym}+0x{disp:x}"},
+      {"end-to-end-jsonl", TraceStyle_t::Custom, false, TraceFormat_t::Hex,
+       Workload.Trace, OutputFormat_t::Jsonl.data()}};
+
+  for (const Variant_t &Variant : Variants) {
+    Opts_t VariantOpts = SymbolizeOpts;
+    VariantOpts.Style = Variant.Style;
+    VariantOpts.LineNumbers = Variant.LineNumbers;
+    VariantOpts.Format = Variant.Format;
+    if (Variant.OutputFormat != nullptr) {
+      VariantOpts.OutputFormat.Compile(Variant.OutputFormat);
+    }
+
+    const char *VariantBegin = Variant.Trace.data();
+    const char *VariantEnd = VariantBegin + Variant.Trace.size();
+    Record(Variant.Stage, Lines, Measure(ColdCache, [&] {
+             OutputSink_t Out(OutputPath);
+             SymbolizeBuffer(Workload.Symbols, VariantOpts, "bench",
+                             VariantBegin, VariantEnd, Out, Stats);
+           }));
+    Results.back().Bytes = Variant.Trace.size();
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  //
+  // Set up the argument parsing.
+  //
+
+  CLI::App Bench("Symbolizer benchmark - Measures the symbolization stages on "
+                 "synthetic traces");
+
+  Bench.allow_windows_style_options();
+  Bench.add_option("--lines", Opts.Lines, "Trace sizes (in lines)")
+      ->delimiter(',')
+      ->capture_default_str();
+  Bench
+      .add_option("--unique-ratios", Opts.UniqueRatios,
+                  "Ratios of unique addresses per line")
+      ->delimiter(',')
+      ->capture_default_str();
+  Bench.add_option("--repeat", Opts.Repeat, "Repeat every measurement")
+      ->default_val(3);
+  Bench.add_option("--seed", Opts.Seed, "Seed of the synthetic workloads")
+      ->default_val(1337);
+  Bench.add_option("--json", Opts.Json, "JSON results (default: stdout)");
+
+  CLI11_PARSE(Bench, argc, argv);
+
+  if (Opts.Repeat == 0) {
+    Opts.Repeat = 1;
+  }
+
+  //
+  // Run the benchmarks.
+  //
+
+  const fs::path OutputPath =
+      fs::temp_directory_path() / "symbolizer-bench.trace";
+  std::vector<Result_t> Results;
+  for (const uint64_t Lines : Opts.Lines) {
+    for (const double UniqueRatio : Opts.UniqueRatios) {
+      const uint64_t Unique =
+          std::clamp<uint64_t>(uint64_t(Lines * UniqueRatio), 1, Lines);
+      fmt::print(stderr, "Benchmarking {} lines with {} unique addresses..\n",
+                 NumberToHuman(Lines), NumberToHuman(Unique));
+      BenchWorkload(Lines, Unique, OutputPath, Results);
+    }
+  }
+
+  std::error_code Ec;
+  fs::remove(OutputPath, Ec);
+
+  //
+  // Dump the results as JSON.
+  //
+
+  fmt::memory_buffer Json;
+  fmt::format_to(std::back_inserter(Json), "[\n");
+  for (size_t Idx = 0; Idx < Results.size(); Idx++) {
+    const Result_t &Result = Results[Idx];
+    const double Seconds = double(Result.BestNs) / 1'000'000'000;
+    fmt::format_to(
+        std::back_inserter(Json),
+        "  {{\"stage\": \"{}\", \"lines\": {}, \"unique\": {}, \"bytes\": {}, "
+        "\"items\": {}, \"best_ns\": {}, \"mean_ns\": {}, "
+        "\"items_per_second\": {:.0f}, \"mb_per_second\": {:.1f}}}{}\n",
+        Result.Stage, Result.Lines, Result.Unique, Result.Bytes, Result.Items,
+        Result.BestNs, Result.MeanNs, double(Result.Items) / Seconds,
+        double(Result.Bytes) / Seconds / (1'024 * 1'024),
+        Idx + 1 < Results.size() ? "," : "");
+  }
+  fmt::format_to(std::back_inserter(Json), "]\n");
+
+  if (Opts.Json.empty()) {
+    fmt::print("{}", fmt::to_string(Json));
+  } else {
+    auto Out = fmt::output_file(Opts.Json.string());
+    Out.print("{}", fmt::to_string(Json));
+  }
+
+  return EXIT_SUCCESS;
+}
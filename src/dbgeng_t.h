@@ -1,12 +1,15 @@
 // Axel '0vercl0k' Souchet - September 12 2020
 #pragma once
+#include "symbolize.h"
 #include <cstdint>
+#include <cstring>
 #include <dbgeng.h>
 #include <filesystem>
 #include <fmt/printf.h>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <windows.h>
 
 namespace fs = std::filesystem;
@@ -21,12 +24,6 @@ namespace fs = std::filesystem;
 #error Platform not supported.
 #endif
 
-//
-// The trace style supported.
-//
-
-enum class TraceStyle_t { Modoff, FullSymbol };
-
 //
 // The below class is the abstraction we use to interact with the DbgEng APIs.
 //
@@ -75,12 +72,10 @@ class DbgEng_t {
   };
 
   //
-  // This is the internal cache. Granted that resolving symbols is a pretty slow
-  // process and the fact that traces usually contain a smaller number of
-  // *unique* addresses executed, this gets us a really nice boost.
+  // This is the internal cache.
   //
 
-  std::unordered_map<uint64_t, std::string> Cache_;
+  SymbolCache_t Cache_;
 
   //
   // The below are the various interfaces we need to do symbol resolution as
@@ -260,76 +255,134 @@ public:
 
   std::optional<std::reference_wrapper<std::string>>
   Symbolize(const uint64_t SymbolAddress, const TraceStyle_t Style) {
-    //
-    // Fast path for the addresses we have symbolized already.
-    //
+    return Cache_.Symbolize(SymbolAddress, [&](const uint64_t Address) {
+      return Resolve(Address, Style);
+    });
+  }
 
-    if (Cache_.contains(SymbolAddress)) {
-      return Cache_.at(SymbolAddress);
-    }
+  //
+  // This returns the symbolized version of |SymbolAddress| according to a
+  // |Style| without going through the cache.
+  //
 
-    //
-    // Slow path, we need to ask dbgeng..
-    //
+  std::optional<std::string> Resolve(const uint64_t SymbolAddress,
+                                     const TraceStyle_t Style) {
+    return Style == TraceStyle_t::Modoff ? SymbolizeModoff(SymbolAddress)
+                                         : SymbolizeFull(SymbolAddress);
+  }
 
-    const auto &Res = Style == TraceStyle_t::Modoff
-                          ? SymbolizeModoff(SymbolAddress)
-                          : SymbolizeFull(SymbolAddress);
+  //
+  // This returns the module and the symbol |SymbolAddress| belongs to,
+  // without going through the cache.
+  //
 
-    //
-    // If there has been an issue during symbolization, bail as it is not
-    // expected.
-    //
+  std::optional<SymbolInfo_t> ResolveInfo(const uint64_t SymbolAddress) {
+    constexpr size_t NameSizeMax = MAX_PATH;
+    char Buffer[NameSizeMax] = {};
 
-    if (!Res) {
+    SymbolInfo_t Info;
+    if (!ModuleByOffset(SymbolAddress, Info.Module, Info.ModuleBase)) {
       return {};
     }
 
     //
-    // Feed the result into the cache.
+    // The names returned by GetNameByOffset look like module!symbol, or just
+    // module when there is no symbol for the address.
     //
 
-    Cache_.emplace(SymbolAddress, *Res);
+    Info.Displacement = SymbolAddress - Info.ModuleBase;
+    uint64_t Displacement = 0;
+    HRESULT Status;
+    {
+#ifdef SYMBOLIZER_INSTRUMENTATION
+      ScopedLatency_t Latency(Latency_t::GetNameByOffset);
+#endif
+      Status = Symbols_->GetNameByOffset(SymbolAddress, &Buffer[0], NameSizeMax,
+                                         nullptr, &Displacement);
+    }
 
-    //
-    // Return the entry directly from the cache.
-    //
+    if (FAILED(Status)) {
+      return Info;
+    }
+
+    const char *Bang = strchr(Buffer, '!');
+    if (Bang != nullptr) {
+      Info.Symbol = Bang + 1;
+      Info.Displacement = Displacement;
+    }
 
-    return Cache_.at(SymbolAddress);
+    return Info;
   }
 
+  //
+  // The address cache.
+  //
+
+  SymbolCache_t &Cache() { return Cache_; }
+
 private:
   //
   // This returns a module+offset symbolization of |SymbolAddress|.
   //
 
   std::optional<std::string> SymbolizeModoff(const uint64_t SymbolAddress) {
-    constexpr size_t NameSizeMax = MAX_PATH;
-    char Buffer[NameSizeMax] = {};
-
     //
     // module+offset style.
     //
 
+    std::string Module;
+    uint64_t Base = 0;
+    if (!ModuleByOffset(SymbolAddress, Module, Base)) {
+      return {};
+    }
+
+    const uint64_t Offset = SymbolAddress - Base;
+    return fmt::format("{}+0x{:x}", Module, Offset);
+  }
+
+  //
+  // Find the module |SymbolAddress| belongs to; its name goes in |Module| and
+  // its base in |ModuleBase|.
+  //
+
+  bool ModuleByOffset(const uint64_t SymbolAddress, std::string &Module,
+                      uint64_t &ModuleBase) {
+    constexpr size_t NameSizeMax = MAX_PATH;
+    char Buffer[NameSizeMax] = {};
+
     ULONG Index;
     ULONG64 Base;
-    HRESULT Status =
-        Symbols_->GetModuleByOffset(SymbolAddress, 0, &Index, &Base);
+    HRESULT Status;
+    {
+#ifdef SYMBOLIZER_INSTRUMENTATION
+      ScopedLatency_t Latency(Latency_t::GetModuleByOffset);
+#endif
+      Status = Symbols_->GetModuleByOffset(SymbolAddress, 0, &Index, &Base);
+    }
+
     if (FAILED(Status)) {
       fmt::print("GetModuleByOffset failed with hr={}\n", Status);
-      return {};
+      return false;
     }
 
     ULONG NameSize;
-    Status = Symbols_->GetModuleNameString(DEBUG_MODNAME_MODULE, Index, Base,
-                                           &Buffer[0], NameSizeMax, &NameSize);
+    {
+#ifdef SYMBOLIZER_INSTRUMENTATION
+      ScopedLatency_t Latency(Latency_t::GetModuleNameString);
+#endif
+      Status = Symbols_->GetModuleNameString(DEBUG_MODNAME_MODULE, Index, Base,
+                                             &Buffer[0], NameSizeMax,
+                                             &NameSize);
+    }
+
     if (FAILED(Status)) {
       fmt::print("GetModuleNameString failed with hr={}\n", Status);
-      return {};
+      return false;
     }
 
-    const uint64_t Offset = SymbolAddress - Base;
-    return fmt::format("{}+0x{:x}", Buffer, Offset);
+    Module = Buffer;
+    ModuleBase = Base;
+    return true;
   }
 
   //
@@ -345,8 +398,15 @@ private:
     char Buffer[NameSizeMax] = {};
 
     uint64_t Displacement = 0;
-    const HRESULT Status = Symbols_->GetNameByOffset(
-        SymbolAddress, &Buffer[0], NameSizeMax, nullptr, &Displacement);
+    HRESULT Status;
+    {
+#ifdef SYMBOLIZER_INSTRUMENTATION
+      ScopedLatency_t Latency(Latency_t::GetNameByOffset);
+#endif
+      Status = Symbols_->GetNameByOffset(SymbolAddress, &Buffer[0], NameSizeMax,
+                                         nullptr, &Displacement);
+    }
+
     if (FAILED(Status)) {
       fmt::print("GetNameByOffset failed with hr={}\n", Status);
       return {};
@@ -0,0 +1,455 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fmt/format.h>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//
+// Run |Callback| over |NumberChunks| chunks in parallel; the calling thread
+// takes care of the first chunk.
+//
+
+template <typename F_t>
+void ParallelForChunks(const size_t NumberChunks, const F_t &Callback) {
+  std::vector<std::thread> Threads;
+  Threads.reserve(NumberChunks);
+  for (size_t Chunk = 1; Chunk < NumberChunks; Chunk++) {
+    Threads.emplace_back(Callback, Chunk);
+  }
+
+  Callback(0);
+  for (auto &Thread : Threads) {
+    Thread.join();
+  }
+}
+
+//
+// Sorts |Values| with a least-significant-digit radix sort, one byte at a
+// time. |Scratch| needs to be as large as |Values| as it is used as the
+// destination of every other pass. Each pass is split across
+// |NumberThreads| threads: every thread builds the histogram of its own chunk
+// and the histograms are then turned into per-thread offsets, which allows
+// every thread to scatter its chunk without any synchronization.
+// Passes over bytes that are the same for every value (the top bytes of kernel
+// addresses for example) are skipped altogether.
+//
+
+inline void RadixSort(const std::span<uint64_t> Values,
+                      const std::span<uint64_t> Scratch,
+                      const uint32_t NumberThreads) {
+  constexpr size_t NumberDigits = 256;
+  constexpr size_t MinChunkSize = 1'024 * 1'024;
+  const size_t Size = Values.size();
+  if (Size < 2) {
+    return;
+  }
+
+  //
+  // Find out which bytes actually differ across the values.
+  //
+
+  uint64_t Differ = 0;
+  const uint64_t First = Values[0];
+  for (const uint64_t Value : Values) {
+    Differ |= Value ^ First;
+  }
+
+  const size_t NumberChunks =
+      std::clamp<size_t>(Size / MinChunkSize, 1, std::max(NumberThreads, 1u));
+  const size_t ChunkSize = (Size + NumberChunks - 1) / NumberChunks;
+  std::vector<std::array<size_t, NumberDigits>> Histograms(NumberChunks);
+
+  uint64_t *Src = Values.data();
+  uint64_t *Dst = Scratch.data();
+  for (uint32_t Shift = 0; Shift < 64; Shift += 8) {
+    if (((Differ >> Shift) & 0xff) == 0) {
+      continue;
+    }
+
+    //
+    // Build the histogram of every chunk.
+    //
+
+    ParallelForChunks(NumberChunks, [&](const size_t Chunk) {
+      auto &Histogram = Histograms[Chunk];
+      Histogram.fill(0);
+      const size_t Start = Chunk * ChunkSize;
+      const size_t End = std::min(Start + ChunkSize, Size);
+      for (size_t Idx = Start; Idx < End; Idx++) {
+        Histogram[(Src[Idx] >> Shift) & 0xff]++;
+      }
+    });
+
+    //
+    // Turn the histograms into the offset where each chunk starts writing
+    // each digit.
+    //
+
+    size_t Offset = 0;
+    for (size_t Digit = 0; Digit < NumberDigits; Digit++) {
+      for (auto &Histogram : Histograms) {
+        const size_t Count = Histogram[Digit];
+        Histogram[Digit] = Offset;
+        Offset += Count;
+      }
+    }
+
+    //
+    // Scatter every chunk into the destination.
+    //
+
+    ParallelForChunks(NumberChunks, [&](const size_t Chunk) {
+      auto &Offsets = Histograms[Chunk];
+      const size_t Start = Chunk * ChunkSize;
+      const size_t End = std::min(Start + ChunkSize, Size);
+      for (size_t Idx = Start; Idx < End; Idx++) {
+        const uint64_t Value = Src[Idx];
+        Dst[Offsets[(Value >> Shift) & 0xff]++] = Value;
+      }
+    });
+
+    std::swap(Src, Dst);
+  }
+
+  if (Src != Values.data()) {
+    std::copy(Src, Src + Size, Values.data());
+  }
+}
+
+//
+// This extracts the set of distinct addresses of a trace without using a hash
+// set. Addresses are appended into a block; when the block is full it gets
+// radix-sorted and deduplicated in place. If that freed at least half of the
+// block, we keep on appending; otherwise the block is spilled on disk as a
+// sorted run. At the end, the runs are merged back into a single sorted list
+// of unique addresses. The block and its sorting scratch space are sized
+// according to a memory budget.
+//
+
+class DistinctAddresses_t {
+  //
+  // The block where addresses get appended, and the scratch space needed to
+  // sort it.
+  //
+
+  std::unique_ptr<uint64_t[]> Block_;
+  std::unique_ptr<uint64_t[]> Scratch_;
+
+  //
+  // How many addresses the block can hold, and how many are in there.
+  //
+
+  size_t Capacity_ = 0;
+  size_t Size_ = 0;
+
+  //
+  // The largest number of addresses the block has held; the pages beyond it
+  // have never been touched.
+  //
+
+  size_t HighWater_ = 0;
+
+  //
+  // The number of threads used to sort the block.
+  //
+
+  uint32_t NumberThreads_ = 1;
+
+  //
+  // Where the sorted runs are spilled, and the runs themselves.
+  //
+
+  fs::path SpillDir_;
+  std::vector<fs::path> Runs_;
+
+public:
+  explicit DistinctAddresses_t(const uint64_t MemoryBudget,
+                               const fs::path &SpillDir,
+                               const uint32_t NumberThreads)
+      : Capacity_(std::max<uint64_t>(MemoryBudget / (2 * sizeof(uint64_t)),
+                                     1'024)),
+        NumberThreads_(NumberThreads), SpillDir_(SpillDir) {
+    Block_ = std::make_unique_for_overwrite<uint64_t[]>(Capacity_);
+    Scratch_ = std::make_unique_for_overwrite<uint64_t[]>(Capacity_);
+  }
+
+  ~DistinctAddresses_t() {
+    for (const auto &Run : Runs_) {
+      std::error_code Ec;
+      fs::remove(Run, Ec);
+    }
+  }
+
+  //
+  // Rule of three.
+  //
+
+  DistinctAddresses_t(const DistinctAddresses_t &) = delete;
+  DistinctAddresses_t &operator=(DistinctAddresses_t &) = delete;
+
+  //
+  // Add an |Address| to the set.
+  //
+
+  [[nodiscard]] bool Push(const uint64_t Address) {
+    Block_[Size_++] = Address;
+    if (Size_ < Capacity_) {
+      return true;
+    }
+
+    return Compact();
+  }
+
+  //
+  // The memory used by the block and its scratch space, in bytes.
+  //
+
+  uint64_t MemoryUsage() const {
+    return std::max(HighWater_, Size_) * 2 * sizeof(uint64_t);
+  }
+
+  //
+  // Returns the sorted list of distinct addresses.
+  //
+
+  [[nodiscard]] std::optional<std::vector<uint64_t>> Finalize() {
+    SortBlock();
+
+    //
+    // If nothing has been spilled, the block has it all.
+    //
+
+    if (Runs_.empty()) {
+      std::vector<uint64_t> Addresses(Block_.get(), Block_.get() + Size_);
+      Release();
+      return Addresses;
+    }
+
+    //
+    // Otherwise, spill what's left and merge every run.
+    //
+
+    if (!Spill()) {
+      return {};
+    }
+
+    Release();
+    return Merge();
+  }
+
+private:
+  //
+  // Sort and deduplicate the block in place.
+  //
+
+  void SortBlock() {
+    HighWater_ = std::max(HighWater_, Size_);
+    RadixSort({Block_.get(), Size_}, {Scratch_.get(), Size_}, NumberThreads_);
+    Size_ = std::unique(Block_.get(), Block_.get() + Size_) - Block_.get();
+  }
+
+  //
+  // Make room in the block; either by deduplicating it or by spilling it on
+  // disk.
+  //
+
+  [[nodiscard]] bool Compact() {
+    SortBlock();
+    if (Size_ <= (Capacity_ / 2)) {
+      return true;
+    }
+
+    return Spill();
+  }
+
+  //
+  // Write the sorted block into a new run on disk.
+  //
+
+  [[nodiscard]] bool Spill() {
+    const auto Now = std::chrono::steady_clock::now().time_since_epoch();
+    const fs::path RunPath =
+        SpillDir_ / fmt::format("symbolizer.{:x}.{}.run",
+                                uint64_t(Now.count()), Runs_.size());
+
+    FILE *Run = fopen(RunPath.string().c_str(), "wb");
+    if (Run == nullptr) {
+      fmt::print("Could not create the run {}\n", RunPath.string());
+      return false;
+    }
+
+    Runs_.emplace_back(RunPath);
+    const size_t Written = fwrite(Block_.get(), sizeof(uint64_t), Size_, Run);
+    fclose(Run);
+    if (Written != Size_) {
+      fmt::print("Could not write the run {}\n", RunPath.string());
+      return false;
+    }
+
+    Size_ = 0;
+    return true;
+  }
+
+  //
+  // Free the block and the scratch space.
+  //
+
+  void Release() {
+    Block_.reset();
+    Scratch_.reset();
+    Capacity_ = 0;
+    Size_ = 0;
+  }
+
+  //
+  // Merge the runs into a single sorted list of distinct addresses.
+  //
+
+  [[nodiscard]] std::optional<std::vector<uint64_t>> Merge() {
+    constexpr size_t ReaderCapacity = 64 * 1'024;
+    struct Reader_t {
+      FILE *File = nullptr;
+      std::vector<uint64_t> Buffer;
+      size_t Cursor = 0;
+
+      bool Refill() {
+        Buffer.resize(ReaderCapacity);
+        Buffer.resize(
+            fread(Buffer.data(), sizeof(uint64_t), Buffer.size(), File));
+        Cursor = 0;
+        return !Buffer.empty();
+      }
+    };
+
+    std::vector<Reader_t> Readers(Runs_.size());
+    const auto CloseReaders = [&] {
+      for (const auto &Reader : Readers) {
+        if (Reader.File != nullptr) {
+          fclose(Reader.File);
+        }
+      }
+    };
+
+    using Head_t = std::pair<uint64_t, size_t>;
+    std::priority_queue<Head_t, std::vector<Head_t>, std::greater<Head_t>>
+        Heads;
+    for (size_t Idx = 0; Idx < Runs_.size(); Idx++) {
+      auto &Reader = Readers[Idx];
+      Reader.File = fopen(Runs_[Idx].string().c_str(), "rb");
+      if (Reader.File == nullptr) {
+        fmt::print("Could not open the run {}\n", Runs_[Idx].string());
+        CloseReaders();
+        return {};
+      }
+
+      if (Reader.Refill()) {
+        Heads.emplace(Reader.Buffer[0], Idx);
+      }
+    }
+
+    std::vector<uint64_t> Addresses;
+    while (!Heads.empty()) {
+      const auto [Address, Idx] = Heads.top();
+      Heads.pop();
+      if (Addresses.empty() || Addresses.back() != Address) {
+        Addresses.emplace_back(Address);
+      }
+
+      auto &Reader = Readers[Idx];
+      Reader.Cursor++;
+      if (Reader.Cursor < Reader.Buffer.size() || Reader.Refill()) {
+        Heads.emplace(Reader.Buffer[Reader.Cursor], Idx);
+      }
+    }
+
+    CloseReaders();
+    return Addresses;
+  }
+};
+
+//
+// This maps an address to its slot, which is its index in the sorted list of
+// distinct addresses. Traces are mostly sequential, so the lookup starts from
+// the slot returned last and gallops from there before falling back to a
+// binary search.
+//
+
+class AddressSlotMap_t {
+  std::vector<uint64_t> Addresses_;
+  size_t Hint_ = 0;
+
+public:
+  explicit AddressSlotMap_t(std::vector<uint64_t> &&Addresses)
+      : Addresses_(std::move(Addresses)) {}
+
+  const std::vector<uint64_t> &Addresses() const { return Addresses_; }
+  size_t Size() const { return Addresses_.size(); }
+
+  //
+  // Returns the slot of |Address| if it is in the map.
+  //
+
+  std::optional<size_t> Lookup(const uint64_t Address) {
+    return Lookup(Address, Hint_);
+  }
+
+  //
+  // Same as above but with the caller's own hint, so that several threads can
+  // look addresses up concurrently.
+  //
+
+  std::optional<size_t> Lookup(const uint64_t Address, size_t &Hint) const {
+    const size_t Size = Addresses_.size();
+    if (Size == 0) {
+      return {};
+    }
+
+    if (Addresses_[Hint] == Address) {
+      return Hint;
+    }
+
+    //
+    // Gallop away from the hint until we have bracketed the address.
+    //
+
+    size_t Low = 0;
+    size_t High = Size;
+    size_t Step = 1;
+    if (Addresses_[Hint] < Address) {
+      Low = Hint + 1;
+      while (Low + Step < Size && Addresses_[Low + Step] < Address) {
+        Low += Step;
+        Step *= 2;
+      }
+      High = std::min(Low + Step + 1, Size);
+    } else {
+      High = Hint;
+      while (High > Step && Addresses_[High - Step] > Address) {
+        High -= Step;
+        Step *= 2;
+      }
+      Low = High > Step ? High - Step : 0;
+    }
+
+    const auto It = std::lower_bound(Addresses_.begin() + Low,
+                                     Addresses_.begin() + High, Address);
+    if (It == Addresses_.begin() + High || *It != Address) {
+      return {};
+    }
+
+    Hint = It - Addresses_.begin();
+    return Hint;
+  }
+};
@@ -0,0 +1,450 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#include "symbol_map_t.h"
+#include "trace_readers.h"
+#include "utils.h"
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fmt/format.h>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//
+// A profile describes the shape of the program a trace is generated from, and
+// how the execution flows through it.
+//
+
+struct Profile_t {
+
+  //
+  // The number of modules, and of functions per module.
+  //
+
+  uint32_t NumberModules = 0;
+  uint32_t FunctionsPerModule = 0;
+
+  //
+  // The maximum number of instructions of a function.
+  //
+
+  uint32_t MaxInstructions = 0;
+
+  //
+  // The number of functions the execution is spread across.
+  //
+
+  uint32_t WorkingSet = 0;
+
+  //
+  // The probability for an instruction to be a call.
+  //
+
+  double CallRate = 0;
+
+  //
+  // The probability for a function to have a loop, and the maximum number of
+  // iterations of a loop.
+  //
+
+  double LoopRate = 0;
+  uint32_t MaxIterations = 0;
+
+  //
+  // The maximum depth of the call stack.
+  //
+
+  uint32_t MaxDepth = 0;
+};
+
+//
+// The various commad line options that the generator supports.
+//
+
+struct GenOpts_t {
+
+  //
+  // The path of the trace to generate.
+  //
+
+  fs::path Output;
+
+  //
+  // The path of the matching symbol map to generate.
+  //
+
+  fs::path SymbolMapPath;
+
+  //
+  // The format of the trace.
+  //
+
+  TraceFormat_t Format = TraceFormat_t::Hex;
+
+  //
+  // The number of addresses in the trace.
+  //
+
+  uint64_t Lines = 0;
+
+  //
+  // The seed the whole generation derives from.
+  //
+
+  uint64_t Seed = 0;
+
+  //
+  // The name of the profile to use.
+  //
+
+  std::string Profile;
+
+  //
+  // Override the working set of the profile if non zero.
+  //
+
+  uint32_t WorkingSet = 0;
+};
+
+GenOpts_t Opts;
+
+//
+// The profiles available.
+//
+
+const std::unordered_map<std::string, Profile_t> Profiles = {
+    //
+    // A small program with a handful of hot functions.
+    //
+
+    {"user", Profile_t{4, 2'048, 256, 64, 0.02, 0.3, 64, 32}},
+
+    //
+    // Kernel-like execution: many modules, deep call stacks and a wide
+    // coverage.
+    //
+
+    {"kernel", Profile_t{32, 8'192, 512, 4'096, 0.04, 0.2, 16, 64}},
+
+    //
+    // Tight loops spinning for a long time, like memcpy or spin locks.
+    //
+
+    {"loopy", Profile_t{2, 1'024, 64, 16, 0.01, 0.9, 10'000, 8}}};
+
+//
+// A function is a sequence of instructions and maybe a loop.
+//
+
+struct Function_t {
+  std::vector<uint64_t> Instructions;
+  uint32_t LoopStart = 0;
+  uint32_t LoopEnd = 0;
+};
+
+//
+// A frame of the call stack: the function executed, where we are in it and
+// the remaining loop iterations.
+//
+
+struct Frame_t {
+  uint32_t Function = 0;
+  uint32_t Instruction = 0;
+  uint32_t Iterations = 0;
+};
+
+//
+// The program a trace executes: its symbols and its functions.
+//
+
+struct Program_t {
+  SymbolMap_t Symbols;
+  std::vector<Function_t> Functions;
+};
+
+//
+// Build a program that follows |Profile|; the functions that make the working
+// set are laid out as instructions of 1 to 15 bytes.
+//
+
+Program_t BuildProgram(std::mt19937_64 &Rng, const Profile_t &Profile) {
+  Program_t Program;
+  std::vector<uint64_t> Starts;
+  std::vector<uint64_t> Sizes;
+  uint64_t Base = 0xfffff80000000000;
+  for (uint32_t ModuleIdx = 0; ModuleIdx < Profile.NumberModules;
+       ModuleIdx++) {
+    uint64_t Address = Base + 0x1000;
+    for (uint32_t FunctionIdx = 0; FunctionIdx < Profile.FunctionsPerModule;
+         FunctionIdx++) {
+      const uint64_t Size = 0x10 + (Rng() % (Profile.MaxInstructions * 8));
+      Program.Symbols.AddSymbol(fmt::format("Function{}", FunctionIdx),
+                                Address);
+      Starts.emplace_back(Address);
+      Sizes.emplace_back(Size);
+      Address = (Address + Size + 0xf) & ~uint64_t(0xf);
+    }
+
+    const uint64_t Size = (Address - Base + 0xfff) & ~uint64_t(0xfff);
+    Program.Symbols.AddModule(fmt::format("mod{}", ModuleIdx), Base, Size);
+    Base += Size + 0x10'000;
+  }
+
+  //
+  // Pick the functions of the working set and lay out their instructions.
+  //
+
+  std::vector<size_t> Indexes(Starts.size());
+  for (size_t Idx = 0; Idx < Indexes.size(); Idx++) {
+    Indexes[Idx] = Idx;
+  }
+
+  std::shuffle(Indexes.begin(), Indexes.end(), Rng);
+  Indexes.resize(std::min<size_t>(Profile.WorkingSet, Indexes.size()));
+  for (const size_t Idx : Indexes) {
+    Function_t Function;
+    for (uint64_t Offset = 0; Offset < Sizes[Idx]; Offset += 1 + (Rng() % 15)) {
+      Function.Instructions.emplace_back(Starts[Idx] + Offset);
+    }
+
+    const uint32_t NumberInstructions = uint32_t(Function.Instructions.size());
+    if (NumberInstructions > 2 &&
+        std::bernoulli_distribution(Profile.LoopRate)(Rng)) {
+      Function.LoopStart = uint32_t(Rng() % (NumberInstructions - 1));
+      Function.LoopEnd =
+          Function.LoopStart + 1 +
+          uint32_t(Rng() % (NumberInstructions - Function.LoopStart - 1));
+    }
+
+    Program.Functions.emplace_back(std::move(Function));
+  }
+
+  return Program;
+}
+
+//
+// The trace being written.
+//
+
+class TraceWriter_t {
+  FILE *File_ = nullptr;
+  std::string Buffer_;
+  uint64_t Previous_ = 0;
+  TraceFormat_t Format_;
+
+public:
+  explicit TraceWriter_t(const TraceFormat_t Format) : Format_(Format) {}
+  ~TraceWriter_t() { Close(); }
+
+  //
+  // Rule of three.
+  //
+
+  TraceWriter_t(const TraceWriter_t &) = delete;
+  TraceWriter_t &operator=(TraceWriter_t &) = delete;
+
+  bool Open(const fs::path &Path) {
+    File_ = fopen(Path.string().c_str(), "wb");
+    if (File_ == nullptr) {
+      fmt::print("Could not create {}\n", Path.string());
+      return false;
+    }
+
+    return true;
+  }
+
+  void Write(const uint64_t Address) {
+    switch (Format_) {
+    case TraceFormat_t::Raw64: {
+      Buffer_.append((const char *)&Address, sizeof(Address));
+      break;
+    }
+
+    case TraceFormat_t::Compact: {
+      AppendCompact(Buffer_, Previous_, Address);
+      Previous_ = Address;
+      break;
+    }
+
+    case TraceFormat_t::Tenet: {
+      AppendTenet(Buffer_, Previous_, Address);
+      Previous_ = Address;
+      break;
+    }
+
+    default: {
+      fmt::format_to(std::back_inserter(Buffer_), "{:#x}\n", Address);
+      break;
+    }
+    }
+
+    if (Buffer_.size() >= 1'024 * 1'024) {
+      Flush();
+    }
+  }
+
+  bool Close() {
+    if (File_ == nullptr) {
+      return true;
+    }
+
+    const bool Flushed = Flush();
+    const bool Closed = fclose(File_) == 0;
+    File_ = nullptr;
+    return Flushed && Closed;
+  }
+
+private:
+  bool Flush() {
+    const size_t Written = fwrite(Buffer_.data(), 1, Buffer_.size(), File_);
+    const bool Success = Written == Buffer_.size();
+    Buffer_.clear();
+    return Success;
+  }
+};
+
+//
+// Execute |Program| for |Opts.Lines| instructions.
+//
+
+void Execute(std::mt19937_64 &Rng, const Profile_t &Profile,
+             const Program_t &Program, TraceWriter_t &Writer) {
+  std::vector<Frame_t> Stack;
+  std::bernoulli_distribution IsCall(Profile.CallRate);
+  const auto &Enter = [&](const uint32_t Function) {
+    const Function_t &F = Program.Functions[Function];
+    const uint32_t Iterations =
+        F.LoopEnd > 0 ? uint32_t(Rng() % (Profile.MaxIterations + 1)) : 0;
+    Stack.emplace_back(Frame_t{Function, 0, Iterations});
+  };
+
+  //
+  // Hot functions are picked more often than the others.
+  //
+
+  const uint32_t NumberFunctions = uint32_t(Program.Functions.size());
+  const auto &PickFunction = [&]() {
+    const double Skew = std::uniform_real_distribution<double>(0, 1)(Rng);
+    return uint32_t(Skew * Skew * NumberFunctions) % NumberFunctions;
+  };
+
+  for (uint64_t Line = 0; Line < Opts.Lines; Line++) {
+    if (Stack.empty()) {
+      Enter(PickFunction());
+    }
+
+    Frame_t &Frame = Stack.back();
+    const Function_t &Function = Program.Functions[Frame.Function];
+    Writer.Write(Function.Instructions[Frame.Instruction]);
+
+    //
+    // Take the loop back-edge if there are iterations left.
+    //
+
+    if (Frame.Instruction == Function.LoopEnd && Frame.Iterations > 0) {
+      Frame.Iterations--;
+      Frame.Instruction = Function.LoopStart;
+      continue;
+    }
+
+    Frame.Instruction++;
+
+    //
+    // Return to the caller if we reached the end of the function.
+    //
+
+    if (Frame.Instruction == Function.Instructions.size()) {
+      Stack.pop_back();
+      continue;
+    }
+
+    //
+    // Or maybe call into another function.
+    //
+
+    if (Stack.size() < Profile.MaxDepth && IsCall(Rng)) {
+      Enter(PickFunction());
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  //
+  // Set up the argument parsing.
+  //
+
+  CLI::App Gen("Symbolizer trace generator - Generates synthetic traces and "
+               "their symbol maps");
+
+  Gen.allow_windows_style_options();
+  Gen.add_option("-o,--output", Opts.Output, "Output trace")->required();
+  Gen.add_option("--symbol-map", Opts.SymbolMapPath, "Output symbol map")
+      ->required();
+
+  const std::unordered_map<std::string, TraceFormat_t> TraceFormatMap = {
+      {"hex", TraceFormat_t::Hex},
+      {"raw64", TraceFormat_t::Raw64},
+      {"compact", TraceFormat_t::Compact},
+      {"tenet", TraceFormat_t::Tenet}};
+
+  Gen.add_option("--format", Opts.Format, "Output trace format")
+      ->transform(CLI::CheckedTransformer(TraceFormatMap, CLI::ignore_case))
+      ->default_val("hex");
+  Gen.add_option("-l,--lines", Opts.Lines, "Number of addresses")
+      ->default_val(1'000'000);
+  Gen.add_option("--seed", Opts.Seed, "Seed of the generation")
+      ->default_val(1337);
+  Gen.add_option("--profile", Opts.Profile, "Profile (user, kernel, loopy)")
+      ->default_val("user");
+  Gen.add_option("--working-set", Opts.WorkingSet,
+                 "Number of functions executed (default: profile's)")
+      ->default_val(0);
+
+  CLI11_PARSE(Gen, argc, argv);
+
+  if (!Profiles.contains(Opts.Profile)) {
+    fmt::print("The profile {} doesn't exist\n", Opts.Profile);
+    return EXIT_FAILURE;
+  }
+
+  Profile_t Profile = Profiles.at(Opts.Profile);
+  if (Opts.WorkingSet > 0) {
+    Profile.WorkingSet = Opts.WorkingSet;
+  }
+
+  //
+  // Build the program and dump its symbols.
+  //
+
+  std::mt19937_64 Rng(Opts.Seed);
+  const Program_t Program = BuildProgram(Rng, Profile);
+  if (!Program.Symbols.Save(Opts.SymbolMapPath)) {
+    return EXIT_FAILURE;
+  }
+
+  //
+  // Execute it.
+  //
+
+  TraceWriter_t Writer(Opts.Format);
+  if (!Writer.Open(Opts.Output)) {
+    return EXIT_FAILURE;
+  }
+
+  Execute(Rng, Profile, Program, Writer);
+  if (!Writer.Close()) {
+    fmt::print("Could not write {}\n", Opts.Output.string());
+    return EXIT_FAILURE;
+  }
+
+  fmt::print("Generated {} addresses over {} functions into {}\n",
+             NumberToHuman(Opts.Lines), Program.Functions.size(),
+             Opts.Output.string());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+//
+// This finds the addresses in arbitrary text (kernel logs, bugcheck analyses,
+// stack dumps, etc.): the hexadecimal tokens that are either prefixed by 0x,
+// or at least 8 digits long, optionally with the backtick WinDbg puts in the
+// middle of 64-bit addresses (fffff803`1d2e3f40). A token has to stand on its
+// own (it can't be glued to a word) and can't be longer than 64 bits.
+//
+// Lines are mostly text that isn't an address, so they are classified 64
+// bytes at a time into bitmaps, 8 bytes per 64-bit word (SWAR): the hex
+// digits, the zeros and the x. The places where a token can start (a run of
+// 8 hex digits, or 0x) fall out of a few shifts and ands of the bitmaps, and
+// only those get looked at one byte at a time. Blocks overlap by 8 bytes so
+// that the runs straddling two blocks are found.
+//
+
+class HexScanner_t {
+  static constexpr uint64_t Ones = 0x0101010101010101;
+  static constexpr uint64_t HighBits = Ones * 0x80;
+  static constexpr size_t BlockSize = 64;
+  static constexpr size_t BlockStep = BlockSize - 8;
+
+  //
+  // Returns the high bit of every byte of |Word| that is strictly between |Low|
+  // and |High|; bytes with their high bit set never are.
+  //
+
+  static uint64_t Between(const uint64_t Word, const uint8_t Low,
+                          const uint8_t High) {
+    const uint64_t Low7 = Word & (Ones * 0x7f);
+    return ((Ones * (0x7f + High)) - Low7) & ~Word &
+           (Low7 + (Ones * (0x7f - Low))) & HighBits;
+  }
+
+  //
+  // Returns the high bit of every byte of |Word| that is |Byte|.
+  //
+
+  static uint64_t Equal(const uint64_t Word, const uint8_t Byte) {
+    const uint64_t Xored = Word ^ (Ones * Byte);
+    return ~(((Xored & (Ones * 0x7f)) + (Ones * 0x7f)) | Xored) & HighBits;
+  }
+
+  //
+  // Gather the high bits of the bytes of |Bits| into a byte.
+  //
+
+  static uint64_t Gather(const uint64_t Bits) {
+    return ((Bits >> 7) * 0x0102040810204080) >> 56;
+  }
+
+  //
+  // The value of every hex digit, |NotHex| for the word characters that
+  // aren't and |NotWord| for the rest.
+  //
+
+  static constexpr uint8_t NotHex = 0x10;
+  static constexpr uint8_t NotWord = 0x20;
+
+  static constexpr auto Classes = []() {
+    std::array<uint8_t, 256> Classes = {};
+    for (size_t C = 0; C < Classes.size(); C++) {
+      const size_t Lower = C | 0x20;
+      if (C >= '0' && C <= '9') {
+        Classes[C] = uint8_t(C - '0');
+      } else if (Lower >= 'a' && Lower <= 'f') {
+        Classes[C] = uint8_t(Lower - 'a' + 10);
+      } else if ((Lower >= 'a' && Lower <= 'z') || C == '_' || C == '`') {
+        Classes[C] = NotHex;
+      } else {
+        Classes[C] = NotWord;
+      }
+    }
+
+    return Classes;
+  }();
+
+  static uint8_t Class(const char C) { return Classes[uint8_t(C)]; }
+
+  //
+  // Parse the token at |Begin| in |Line|. On success, this returns its end and
+  // its value in |Address|; otherwise, it returns where the scan can resume.
+  //
+
+  static size_t ParseToken(const std::string_view Line, const size_t Begin,
+                           uint64_t &Address, bool &Parsed) {
+    Parsed = false;
+    size_t Current = Begin;
+    const bool Prefixed = Current + 1 < Line.size() && Line[Current] == '0' &&
+                          (Line[Current + 1] | 0x20) == 'x';
+    if (Prefixed) {
+      Current += 2;
+    }
+
+    Address = 0;
+    size_t Digits = 0;
+    bool Backtick = false;
+    for (; Current < Line.size(); Current++) {
+      const uint8_t Value = Class(Line[Current]);
+      if (Value < NotHex) {
+        Address = (Address << 4) | Value;
+        Digits++;
+        continue;
+      }
+
+      //
+      // WinDbg splits 64-bit addresses in two halves with a backtick.
+      //
+
+      if (Line[Current] == '`' && !Backtick && Digits > 0 &&
+          Current + 1 < Line.size() && Class(Line[Current + 1]) < NotHex) {
+        Backtick = true;
+        continue;
+      }
+
+      break;
+    }
+
+    if (Begin > 0 && Class(Line[Begin - 1]) != NotWord) {
+      return Current;
+    }
+
+    if (Current < Line.size() && Class(Line[Current]) != NotWord) {
+      return Current;
+    }
+
+    if (Digits > 16 || Digits < (Prefixed ? 1 : 8)) {
+      return Current;
+    }
+
+    Parsed = true;
+    return Current;
+  }
+
+public:
+  //
+  // Invoke |Callback| with the beginning, the end and the value of every token
+  // of |Line| that looks like an address.
+  //
+
+  template <typename F_t>
+  static void ForEachToken(const std::string_view Line, F_t &&Callback) {
+    size_t Position = 0;
+    size_t Next = 0;
+    while (Position < Line.size()) {
+
+      //
+      // Classify the block a word at a time; the last word of the line is
+      // padded with zeros, which aren't hex digits.
+      //
+
+      const size_t Size = std::min(BlockSize, Line.size() - Position);
+      uint64_t Hex = 0;
+      uint64_t Zeros = 0;
+      uint64_t Xs = 0;
+      for (size_t Idx = 0; Idx * sizeof(uint64_t) < Size; Idx++) {
+        const size_t Offset = Idx * sizeof(uint64_t);
+        uint64_t Word = 0;
+        memcpy(&Word, Line.data() + Position + Offset,
+               std::min(sizeof(Word), Size - Offset));
+        const uint64_t Lower = Word | (Ones * 0x20);
+        const uint64_t Digits = Between(Word, '0' - 1, '9' + 1);
+        const uint64_t Letters = Between(Lower, 'a' - 1, 'f' + 1);
+        const uint64_t Backticks = Equal(Word, '`');
+        const uint32_t Shift = uint32_t(Idx * 8);
+        Hex |= Gather(Digits | Letters | Backticks) << Shift;
+        Zeros |= Gather(Equal(Word, '0')) << Shift;
+        Xs |= Gather(Equal(Lower, 'x')) << Shift;
+      }
+
+      //
+      // A token starts with 0x or a run of 8 hex digits. The runs that go past
+      // the block are only seen by the next one, unless this is the last.
+      //
+
+      uint64_t Runs = Hex & (Hex >> 1);
+      Runs &= Runs >> 2;
+      Runs &= Runs >> 4;
+      const bool Last = Position + BlockSize >= Line.size();
+      const size_t Step = Last ? Size : BlockStep;
+      uint64_t Candidates = (Runs | (Zeros & (Xs >> 1)));
+      if (Step < BlockSize) {
+        Candidates &= (1ULL << Step) - 1;
+      }
+
+      while (Candidates != 0) {
+        const size_t Begin = Position + std::countr_zero(Candidates);
+        Candidates &= Candidates - 1;
+        if (Begin < Next) {
+          continue;
+        }
+
+        uint64_t Address = 0;
+        bool Parsed = false;
+        const size_t End = ParseToken(Line, Begin, Address, Parsed);
+        if (Parsed) {
+          Callback(Begin, End, Address);
+        }
+
+        Next = End;
+      }
+
+      Position = std::max(Position + Step, Next);
+    }
+  }
+};
@@ -0,0 +1,289 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <fmt/format.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//
+// The instrumentation below is only compiled in when SYMBOLIZER_INSTRUMENTATION
+// is defined; every call site is guarded by it so that it costs nothing
+// otherwise.
+//
+
+//
+// A latency histogram with logarithmic buckets, HDR-style: every power of two
+// is split in |NumberSubBuckets| linear sub-buckets, which bounds the relative
+// error of a value to 1 / |NumberSubBuckets| while keeping the histogram
+// small and the recording a couple of instructions.
+//
+
+class LatencyHistogram_t {
+  static constexpr uint32_t SubBucketBits = 3;
+  static constexpr uint32_t NumberSubBuckets = 1 << SubBucketBits;
+  static constexpr size_t NumberBuckets =
+      (64 - SubBucketBits + 1) * NumberSubBuckets;
+
+  std::array<uint64_t, NumberBuckets> Counts_ = {};
+  uint64_t Count_ = 0;
+  uint64_t Sum_ = 0;
+  uint64_t Max_ = 0;
+
+  //
+  // Values below |NumberSubBuckets| get a bucket each; the others are
+  // bucketed according to their most significant bit and the bits that
+  // follow it.
+  //
+
+  static size_t BucketIndex(const uint64_t Value) {
+    if (Value < NumberSubBuckets) {
+      return size_t(Value);
+    }
+
+    const uint32_t Shift = 63 - std::countl_zero(Value) - SubBucketBits;
+    const uint64_t SubBucket = (Value >> Shift) & (NumberSubBuckets - 1);
+    return ((Shift + 1) * NumberSubBuckets) + size_t(SubBucket);
+  }
+
+  //
+  // The largest value that falls in the bucket |Index|.
+  //
+
+  static uint64_t BucketHighest(const size_t Index) {
+    if (Index < NumberSubBuckets) {
+      return Index;
+    }
+
+    const uint32_t Shift = uint32_t(Index / NumberSubBuckets) - 1;
+    const uint64_t SubBucket = Index % NumberSubBuckets;
+    return ((NumberSubBuckets + SubBucket + 1) << Shift) - 1;
+  }
+
+public:
+  void Record(const uint64_t Value) {
+    Counts_[BucketIndex(Value)]++;
+    Count_++;
+    Sum_ += Value;
+    Max_ = std::max(Max_, Value);
+  }
+
+  uint64_t Count() const { return Count_; }
+  uint64_t Mean() const { return Count_ > 0 ? Sum_ / Count_ : 0; }
+  uint64_t Max() const { return Max_; }
+
+  //
+  // Returns the value below which |Quantile| of the recorded values fall.
+  //
+
+  uint64_t Percentile(const double Quantile) const {
+    const uint64_t Rank =
+        std::max<uint64_t>(uint64_t(Quantile * double(Count_) + 0.5), 1);
+    uint64_t Seen = 0;
+    for (size_t Idx = 0; Idx < NumberBuckets; Idx++) {
+      Seen += Counts_[Idx];
+      if (Seen >= Rank) {
+        return std::min(BucketHighest(Idx), Max_);
+      }
+    }
+
+    return Max_;
+  }
+};
+
+//
+// The latencies we keep track of.
+//
+
+enum class Latency_t : size_t {
+  CacheProbe,
+  BackendResolve,
+  GetModuleByOffset,
+  GetModuleNameString,
+  GetNameByOffset,
+  OutputFlush,
+  Count
+};
+
+//
+// The cache efficiency of a module.
+//
+
+struct ModuleCounters_t {
+  uint64_t Hits = 0;
+  uint64_t Misses = 0;
+  uint64_t Failures = 0;
+};
+
+//
+// This gathers the latency histograms and the per-module counters. Dumps are
+// triggered at exit, or on demand by a signal (SIGUSR1, or SIGBREAK on
+// Windows); as nothing much can be done from a signal handler, the handler
+// only raises a flag that the symbolization checks between batches of lines.
+//
+
+class Instrumentation_t {
+  std::array<LatencyHistogram_t, size_t(Latency_t::Count)> Histograms_;
+
+  //
+  // The counters of every module, and the module every address that went
+  // through the backend belongs to (so that cache hits can be accounted to
+  // it).
+  //
+
+  std::unordered_map<std::string, ModuleCounters_t> Modules_;
+  std::unordered_map<uint64_t, ModuleCounters_t *> AddressModules_;
+
+  static inline volatile std::sig_atomic_t DumpRequested_ = 0;
+
+public:
+  void Record(const Latency_t Latency, const uint64_t Ns) {
+    Histograms_[size_t(Latency)].Record(Ns);
+  }
+
+  //
+  // Account a cache hit on |Address|.
+  //
+
+  void Hit(const uint64_t Address) {
+    const auto &It = AddressModules_.find(Address);
+    if (It != AddressModules_.end()) {
+      It->second->Hits++;
+    }
+  }
+
+  //
+  // Account the resolution of |Address| by the backend. The module is taken
+  // from the symbol itself ('mod!sym+0x..' or 'mod+0x..').
+  //
+
+  void Resolved(const uint64_t Address,
+                const std::optional<std::string> &Symbol) {
+    if (!Symbol.has_value()) {
+      Modules_["<unknown>"].Failures++;
+      return;
+    }
+
+    const std::string_view Name(*Symbol);
+    const std::string Module(Name.substr(0, Name.find_first_of("!+")));
+    ModuleCounters_t &Counters = Modules_[Module];
+    Counters.Misses++;
+    AddressModules_.emplace(Address, &Counters);
+  }
+
+  //
+  // Install the signal handler that requests a dump.
+  //
+
+  static void InstallSignalHandler() {
+#if defined(_WIN32)
+    std::signal(SIGBREAK, [](int) { DumpRequested_ = 1; });
+#else
+    std::signal(SIGUSR1, [](int) { DumpRequested_ = 1; });
+#endif
+  }
+
+  //
+  // Dump if a signal asked for it.
+  //
+
+  void DumpIfRequested() {
+    if (DumpRequested_ == 0) {
+      return;
+    }
+
+    DumpRequested_ = 0;
+    Dump();
+  }
+
+  //
+  // Dump the histograms and the counters on stderr.
+  //
+
+  void Dump() const {
+    constexpr std::array<const char *, size_t(Latency_t::Count)> Names = {
+        "cache-probe",         "backend-resolve", "GetModuleByOffset",
+        "GetModuleNameString", "GetNameByOffset", "output-flush"};
+
+    fmt::print(stderr, "\n{:<20} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} "
+                       "{:>10}\n",
+               "latency (ns)", "count", "mean", "p50", "p90", "p99", "p99.9",
+               "max");
+    for (size_t Idx = 0; Idx < Histograms_.size(); Idx++) {
+      const LatencyHistogram_t &Histogram = Histograms_[Idx];
+      if (Histogram.Count() == 0) {
+        continue;
+      }
+
+      fmt::print(stderr,
+                 "{:<20} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+                 Names[Idx], Histogram.Count(), Histogram.Mean(),
+                 Histogram.Percentile(0.5), Histogram.Percentile(0.9),
+                 Histogram.Percentile(0.99), Histogram.Percentile(0.999),
+                 Histogram.Max());
+    }
+
+    //
+    // The modules with the most misses first, as this is where the time
+    // goes.
+    //
+
+    std::vector<std::pair<std::string, ModuleCounters_t>> Modules(
+        Modules_.begin(), Modules_.end());
+    std::sort(Modules.begin(), Modules.end(), [](const auto &A, const auto &B) {
+      return A.second.Misses > B.second.Misses;
+    });
+
+    fmt::print(stderr, "\n{:<30} {:>12} {:>12} {:>12} {:>8}\n", "module",
+               "hits", "misses", "failures", "hit %");
+    for (const auto &[Module, Counters] : Modules) {
+      const uint64_t Lookups = Counters.Hits + Counters.Misses;
+      fmt::print(stderr, "{:<30} {:>12} {:>12} {:>12} {:>8.1f}\n", Module,
+                 Counters.Hits, Counters.Misses, Counters.Failures,
+                 Lookups > 0 ? (double(Counters.Hits) * 100) / double(Lookups)
+                             : 0.);
+    }
+  }
+};
+
+//
+// The instrumentation of the process.
+//
+
+inline Instrumentation_t &Instrumentation() {
+  static Instrumentation_t Instance;
+  return Instance;
+}
+
+//
+// Record the time spent in its scope into a latency histogram.
+//
+
+class ScopedLatency_t {
+  Latency_t Latency_;
+  chrono::steady_clock::time_point Start_;
+
+public:
+  explicit ScopedLatency_t(const Latency_t Latency)
+      : Latency_(Latency), Start_(chrono::steady_clock::now()) {}
+
+  ~ScopedLatency_t() {
+    Instrumentation().Record(Latency_, NanosecondsSince(Start_));
+  }
+
+  //
+  // Rule of three.
+  //
+
+  ScopedLatency_t(const ScopedLatency_t &) = delete;
+  ScopedLatency_t &operator=(ScopedLatency_t &) = delete;
+};
@@ -0,0 +1,516 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fmt/format.h>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+//
+// The I/O engines the traces can be read and the outputs written with.
+//
+
+enum class IoEngine_t { Blocking, IoUring };
+
+//
+// A buffer registered with the ring.
+//
+
+struct IoBuffer_t {
+  void *Base = nullptr;
+  size_t Size = 0;
+};
+
+//
+// This is a minimal io_uring: operations are queued in the submission queue,
+// submitted in one go and their completions reaped one at a time. Buffers can
+// be registered up front so that the kernel doesn't have to map them for
+// every operation. It only is available on Linux; |Init| fails elsewhere.
+//
+
+class IoRing_t {
+#if defined(__linux__)
+  int Fd_ = -1;
+
+  //
+  // The rings shared with the kernel, and the submission queue entries.
+  //
+
+  void *Rings_ = nullptr;
+  size_t RingsSize_ = 0;
+  io_uring_sqe *Sqes_ = nullptr;
+  size_t SqesSize_ = 0;
+
+  unsigned *SqHead_ = nullptr;
+  unsigned *SqTail_ = nullptr;
+  unsigned SqMask_ = 0;
+  unsigned *SqArray_ = nullptr;
+  unsigned *CqHead_ = nullptr;
+  unsigned *CqTail_ = nullptr;
+  unsigned CqMask_ = 0;
+  io_uring_cqe *Cqes_ = nullptr;
+#endif
+
+  uint32_t Entries_ = 0;
+
+  //
+  // The operations queued but not submitted yet, and the ones submitted but
+  // not reaped yet.
+  //
+
+  uint32_t Queued_ = 0;
+  uint32_t InFlight_ = 0;
+
+public:
+  IoRing_t() = default;
+  ~IoRing_t() {
+#if defined(__linux__)
+    if (Sqes_ != nullptr) {
+      munmap(Sqes_, SqesSize_);
+    }
+
+    if (Rings_ != nullptr) {
+      munmap(Rings_, RingsSize_);
+    }
+
+    if (Fd_ != -1) {
+      close(Fd_);
+    }
+#endif
+  }
+
+  //
+  // Rule of three.
+  //
+
+  IoRing_t(const IoRing_t &) = delete;
+  IoRing_t &operator=(IoRing_t &) = delete;
+
+  //
+  // Is io_uring available? It might not be if the kernel is too old, if it
+  // has been disabled (kernel.io_uring_disabled) or filtered by seccomp.
+  //
+
+  static bool Supported() {
+    IoRing_t Ring;
+    return Ring.Init(1);
+  }
+
+  //
+  // Set up a ring with room for |Entries| operations.
+  //
+
+  bool Init(const uint32_t Entries) {
+#if defined(__linux__)
+    io_uring_params Params;
+    memset(&Params, 0, sizeof(Params));
+    Fd_ = int(syscall(__NR_io_uring_setup, Entries, &Params));
+    if (Fd_ == -1) {
+      return false;
+    }
+
+    //
+    // Both rings are mapped with a single mapping; every kernel that knows
+    // about IORING_OP_READ does that.
+    //
+
+    if ((Params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+      return false;
+    }
+
+    RingsSize_ = std::max(
+        Params.sq_off.array + Params.sq_entries * sizeof(unsigned),
+        Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe));
+    Rings_ = mmap(nullptr, RingsSize_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, Fd_, IORING_OFF_SQ_RING);
+    if (Rings_ == MAP_FAILED) {
+      Rings_ = nullptr;
+      return false;
+    }
+
+    SqesSize_ = Params.sq_entries * sizeof(io_uring_sqe);
+    void *Sqes = mmap(nullptr, SqesSize_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, Fd_, IORING_OFF_SQES);
+    if (Sqes == MAP_FAILED) {
+      return false;
+    }
+
+    Sqes_ = (io_uring_sqe *)Sqes;
+    uint8_t *Rings = (uint8_t *)Rings_;
+    SqHead_ = (unsigned *)(Rings + Params.sq_off.head);
+    SqTail_ = (unsigned *)(Rings + Params.sq_off.tail);
+    SqMask_ = *(unsigned *)(Rings + Params.sq_off.ring_mask);
+    SqArray_ = (unsigned *)(Rings + Params.sq_off.array);
+    CqHead_ = (unsigned *)(Rings + Params.cq_off.head);
+    CqTail_ = (unsigned *)(Rings + Params.cq_off.tail);
+    CqMask_ = *(unsigned *)(Rings + Params.cq_off.ring_mask);
+    Cqes_ = (io_uring_cqe *)(Rings + Params.cq_off.cqes);
+    Entries_ = Params.sq_entries;
+    return true;
+#else
+    static_cast<void>(Entries);
+    return false;
+#endif
+  }
+
+  //
+  // Register |Buffers|; the operations refer to them by their index.
+  //
+
+  bool RegisterBuffers(const std::vector<IoBuffer_t> &Buffers) {
+#if defined(__linux__)
+    std::vector<iovec> Iovecs;
+    Iovecs.reserve(Buffers.size());
+    for (const IoBuffer_t &Buffer : Buffers) {
+      Iovecs.push_back(iovec{Buffer.Base, Buffer.Size});
+    }
+
+    return syscall(__NR_io_uring_register, Fd_, IORING_REGISTER_BUFFERS,
+                   Iovecs.data(), unsigned(Iovecs.size())) == 0;
+#else
+    static_cast<void>(Buffers);
+    return false;
+#endif
+  }
+
+  //
+  // Queue a read of |Size| bytes at |Offset| of |Fd| into |Buffer|. If the
+  // buffer is registered, |BufferIndex| is its index; otherwise it is -1.
+  // |UserData| identifies the operation when it completes.
+  //
+
+  bool Read(const int Fd, void *Buffer, const uint32_t Size,
+            const uint64_t Offset, const int BufferIndex,
+            const uint64_t UserData) {
+#if defined(__linux__)
+    return Queue(BufferIndex == -1 ? IORING_OP_READ : IORING_OP_READ_FIXED, Fd,
+                 Buffer, Size, Offset, BufferIndex, UserData);
+#else
+    static_cast<void>(Fd);
+    static_cast<void>(Buffer);
+    static_cast<void>(Size);
+    static_cast<void>(Offset);
+    static_cast<void>(BufferIndex);
+    static_cast<void>(UserData);
+    return false;
+#endif
+  }
+
+  //
+  // Queue a write; see |Read|.
+  //
+
+  bool Write(const int Fd, const void *Buffer, const uint32_t Size,
+             const uint64_t Offset, const int BufferIndex,
+             const uint64_t UserData) {
+#if defined(__linux__)
+    return Queue(BufferIndex == -1 ? IORING_OP_WRITE : IORING_OP_WRITE_FIXED,
+                 Fd, Buffer, Size, Offset, BufferIndex, UserData);
+#else
+    static_cast<void>(Fd);
+    static_cast<void>(Buffer);
+    static_cast<void>(Size);
+    static_cast<void>(Offset);
+    static_cast<void>(BufferIndex);
+    static_cast<void>(UserData);
+    return false;
+#endif
+  }
+
+  //
+  // Submit the operations queued.
+  //
+
+  bool Submit() { return Enter(0); }
+
+  //
+  // Reap a completion, waiting for one if needed. |Result| is what the
+  // equivalent syscall would have returned, or -errno.
+  //
+
+  bool Complete(uint64_t &UserData, int32_t &Result) {
+#if defined(__linux__)
+    if (InFlight_ + Queued_ == 0) {
+      return false;
+    }
+
+    while (true) {
+      const unsigned Head = *CqHead_;
+      const unsigned Tail =
+          std::atomic_ref<unsigned>(*CqTail_).load(std::memory_order_acquire);
+      if (Head != Tail) {
+        const io_uring_cqe &Cqe = Cqes_[Head & CqMask_];
+        UserData = Cqe.user_data;
+        Result = Cqe.res;
+        std::atomic_ref<unsigned>(*CqHead_).store(Head + 1,
+                                                  std::memory_order_release);
+        InFlight_--;
+        return true;
+      }
+
+      if (!Enter(1)) {
+        return false;
+      }
+    }
+#else
+    static_cast<void>(UserData);
+    static_cast<void>(Result);
+    return false;
+#endif
+  }
+
+  uint32_t InFlight() const { return InFlight_ + Queued_; }
+
+private:
+#if defined(__linux__)
+  bool Queue(const uint8_t Opcode, const int Fd, const void *Buffer,
+             const uint32_t Size, const uint64_t Offset,
+             const int BufferIndex, const uint64_t UserData) {
+
+    //
+    // Make room in the submission queue if it is full.
+    //
+
+    const unsigned Tail = *SqTail_;
+    const unsigned Head =
+        std::atomic_ref<unsigned>(*SqHead_).load(std::memory_order_acquire);
+    if (Tail - Head == Entries_ && !Submit()) {
+      return false;
+    }
+
+    const unsigned Index = Tail & SqMask_;
+    io_uring_sqe &Sqe = Sqes_[Index];
+    memset(&Sqe, 0, sizeof(Sqe));
+    Sqe.opcode = Opcode;
+    Sqe.fd = Fd;
+    Sqe.addr = uint64_t(Buffer);
+    Sqe.len = Size;
+    Sqe.off = Offset;
+    Sqe.buf_index = uint16_t(BufferIndex == -1 ? 0 : BufferIndex);
+    Sqe.user_data = UserData;
+    SqArray_[Index] = Index;
+    std::atomic_ref<unsigned>(*SqTail_).store(Tail + 1,
+                                              std::memory_order_release);
+    Queued_++;
+    return true;
+  }
+#endif
+
+  //
+  // Submit what is queued and wait for |MinComplete| completions.
+  //
+
+  bool Enter(const uint32_t MinComplete) {
+#if defined(__linux__)
+    while (Queued_ > 0 || MinComplete > 0) {
+      const unsigned Flags = MinComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+      const long Submitted = syscall(__NR_io_uring_enter, Fd_, Queued_,
+                                     MinComplete, Flags, nullptr, 0);
+      if (Submitted < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        return false;
+      }
+
+      Queued_ -= uint32_t(Submitted);
+      InFlight_ += uint32_t(Submitted);
+      if (MinComplete > 0 || Queued_ == 0) {
+        break;
+      }
+    }
+
+    return true;
+#else
+    static_cast<void>(MinComplete);
+    return false;
+#endif
+  }
+};
+
+//
+// This writes buffers out at the end of a file with io_uring, keeping several
+// writes in flight: |Write| hands a full buffer over to the ring and gives an
+// empty one back. The buffers are registered with the ring, and as they are
+// swapped around rather than copied, a write only is a registered one if the
+// buffer hasn't been reallocated.
+//
+
+class RingWriter_t {
+  static constexpr size_t NumberSlots = 4;
+
+  struct Slot_t {
+    OutputBuffer_t Buffer;
+    uint64_t Offset = 0;
+    bool InFlight = false;
+  };
+
+  IoRing_t Ring_;
+  int Fd_ = -1;
+  uint64_t Offset_ = 0;
+  std::array<Slot_t, NumberSlots> Slots_;
+  std::vector<IoBuffer_t> Registered_;
+
+public:
+  RingWriter_t() = default;
+  ~RingWriter_t() { Drain(); }
+
+  //
+  // Rule of three.
+  //
+
+  RingWriter_t(const RingWriter_t &) = delete;
+  RingWriter_t &operator=(RingWriter_t &) = delete;
+
+  //
+  // Set up the ring to write into |Fd|. |Buffer| is the buffer the caller
+  // formats into; it gets registered along with the ones of the slots, all of
+  // |Capacity| bytes.
+  //
+
+  bool Init(const int Fd, OutputBuffer_t &Buffer, const size_t Capacity) {
+    if (!Ring_.Init(uint32_t(NumberSlots))) {
+      return false;
+    }
+
+    Fd_ = Fd;
+    Buffer.reserve(Capacity);
+    Registered_.push_back(IoBuffer_t{Buffer.data(), Buffer.capacity()});
+    for (Slot_t &Slot : Slots_) {
+      Slot.Buffer.reserve(Capacity);
+      Registered_.push_back(
+          IoBuffer_t{Slot.Buffer.data(), Slot.Buffer.capacity()});
+    }
+
+    //
+    // If the buffers can't be registered (RLIMIT_MEMLOCK), the writes just
+    // won't be registered ones.
+    //
+
+    if (!Ring_.RegisterBuffers(Registered_)) {
+      Registered_.clear();
+    }
+
+    return true;
+  }
+
+  //
+  // Queue the write of |Buffer| and swap it with an empty buffer.
+  //
+
+  bool Write(OutputBuffer_t &Buffer) {
+    size_t SlotIdx = 0;
+    while (Slots_[SlotIdx].InFlight) {
+      if (++SlotIdx < NumberSlots) {
+        continue;
+      }
+
+      if (!Reap()) {
+        return false;
+      }
+
+      SlotIdx = 0;
+    }
+
+    Slot_t &Slot = Slots_[SlotIdx];
+    std::swap(Slot.Buffer, Buffer);
+    Buffer.clear();
+    Slot.Offset = Offset_;
+    Slot.InFlight = true;
+    Offset_ += Slot.Buffer.size();
+
+    int BufferIndex = -1;
+    for (size_t Idx = 0; Idx < Registered_.size(); Idx++) {
+      if (Registered_[Idx].Base == Slot.Buffer.data() &&
+          Registered_[Idx].Size >= Slot.Buffer.size()) {
+        BufferIndex = int(Idx);
+        break;
+      }
+    }
+
+    if (!Ring_.Write(Fd_, Slot.Buffer.data(), uint32_t(Slot.Buffer.size()),
+                     Slot.Offset, BufferIndex, SlotIdx) ||
+        !Ring_.Submit()) {
+      fmt::print("Could not queue the write at {:#x}\n", Slot.Offset);
+      Slot.InFlight = false;
+      return false;
+    }
+
+    return true;
+  }
+
+  //
+  // Wait for every write in flight. If a completion can't be reaped, the ones
+  // still in flight never will be either, so give up.
+  //
+
+  bool Drain() {
+    bool Success = true;
+    while (Ring_.InFlight() > 0) {
+      const uint32_t InFlight = Ring_.InFlight();
+      Success = Reap() && Success;
+      if (Ring_.InFlight() == InFlight) {
+        return false;
+      }
+    }
+
+    return Success;
+  }
+
+private:
+  //
+  // Reap the completion of a write; short writes are completed synchronously.
+  //
+
+  bool Reap() {
+    uint64_t SlotIdx = 0;
+    int32_t Result = 0;
+    if (!Ring_.Complete(SlotIdx, Result)) {
+      fmt::print("Could not reap a write completion\n");
+      return false;
+    }
+
+    Slot_t &Slot = Slots_[SlotIdx];
+    Slot.InFlight = false;
+    if (Result < 0) {
+      fmt::print("Could not write at {:#x} ({})\n", Slot.Offset,
+                 strerror(-Result));
+      return false;
+    }
+
+#if defined(__linux__)
+    size_t Written = size_t(Result);
+    while (Written < Slot.Buffer.size()) {
+      const ssize_t Amount =
+          pwrite(Fd_, Slot.Buffer.data() + Written,
+                 Slot.Buffer.size() - Written, Slot.Offset + Written);
+      if (Amount < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (Amount <= 0) {
+        fmt::print("Could not write at {:#x}\n", Slot.Offset + Written);
+        return false;
+      }
+
+      Written += size_t(Amount);
+    }
+#endif
+
+    return true;
+  }
+};
@@ -0,0 +1,270 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fmt/format.h>
+#include <string>
+#include <vector>
+
+//
+// This folds the loops of a trace: when the last lines repeat the ones right
+// before them (a spin loop, a memcpy loop, etc.), only the first iteration of
+// the loop body is kept, followed by a line saying how many more times it
+// ran. Everything else goes through verbatim.
+//
+// The addresses of the lines are hashed with a polynomial rolling hash, which
+// gives the hash of any window of the recent addresses in constant time. The
+// hash of the last |GramSize| addresses is looked up in a small table to find
+// where they were last seen, which is the period of the loop we might be in;
+// the two last windows of that period are then compared (hashes first, then
+// the addresses) to confirm it. Once in a loop, every line is compared with
+// the one a period before it until the loop is left.
+//
+// The lines are delayed by up to |MaxPeriod| lines, so that the second
+// iteration of a loop can be dropped once it is confirmed.
+//
+
+class LoopFolder_t {
+  static constexpr uint64_t GramSize = 4;
+  static constexpr uint64_t TableBits = 12;
+  static constexpr uint64_t HashBase = 0x100000001b3;
+
+  //
+  // The largest loop body that gets folded.
+  //
+
+  uint64_t MaxPeriod_ = 0;
+
+  //
+  // The recent addresses and the rolling hashes of the trace up to them, in
+  // rings indexed by the line index; |Seen_| is the number of lines pushed.
+  //
+
+  std::vector<uint64_t> Addresses_;
+  std::vector<uint64_t> Hashes_;
+  uint64_t Mask_ = 0;
+  uint64_t Seen_ = 0;
+
+  //
+  // The powers of the base, to extract the hash of a window.
+  //
+
+  std::vector<uint64_t> Powers_;
+
+  //
+  // Where the hashes of |GramSize| addresses were last seen (plus one).
+  //
+
+  std::vector<uint64_t> LastSeen_;
+
+  //
+  // The delayed lines, in a ring whose strings are reused.
+  //
+
+  std::vector<std::string> Pending_;
+  std::string Line_;
+  uint64_t PendingHead_ = 0;
+  uint64_t PendingSize_ = 0;
+
+  //
+  // The number of lines since the last fold (or flush): a loop only gets
+  // folded if its first iteration is right before the second one in the
+  // output.
+  //
+
+  uint64_t RunLength_ = 0;
+
+  //
+  // The loop we are in if |Period_| is not zero; |Phase_| is the position in
+  // its body and |Repeats_| the number of iterations dropped.
+  //
+
+  uint64_t Period_ = 0;
+  uint64_t Phase_ = 0;
+  uint64_t Repeats_ = 0;
+
+  //
+  // How many lines got folded.
+  //
+
+  uint64_t Folded_ = 0;
+
+  uint64_t Address(const uint64_t Index) const {
+    return Addresses_[Index & Mask_];
+  }
+
+  //
+  // Returns the hash of the addresses in [|Begin|, |End|).
+  //
+
+  uint64_t WindowHash(const uint64_t Begin, const uint64_t End) const {
+    const uint64_t Before = Begin == 0 ? 0 : Hashes_[(Begin - 1) & Mask_];
+    return Hashes_[(End - 1) & Mask_] - (Before * Powers_[End - Begin]);
+  }
+
+  template <typename Buffer_t> void EmitOldest(Buffer_t &Buffer) {
+    const std::string &Line = Pending_[PendingHead_];
+    Buffer.append(Line.data(), Line.data() + Line.size());
+    PendingHead_ = (PendingHead_ + 1) % Pending_.size();
+    PendingSize_--;
+  }
+
+  void PushPending(const std::string &Line) {
+    const uint64_t Tail = (PendingHead_ + PendingSize_) % Pending_.size();
+    Pending_[Tail].assign(Line);
+    PendingSize_++;
+  }
+
+  //
+  // Write the repeat count of the loop we are in; the lines of its last,
+  // partial, iteration are the start of a new run.
+  //
+
+  template <typename Buffer_t> void EndLoop(Buffer_t &Buffer) {
+    fmt::format_to(std::back_inserter(Buffer),
+                   "[the last {} lines repeat {} more times]\n", Period_,
+                   Repeats_);
+    Folded_ += Period_ * Repeats_;
+    Period_ = 0;
+    RunLength_ = PendingSize_;
+  }
+
+  //
+  // Is the last line the end of the second iteration of a loop of |Period|
+  // lines?
+  //
+
+  bool IsLoop(const uint64_t Period) const {
+    if (Period == 0 || Period > MaxPeriod_ || (2 * Period) > RunLength_) {
+      return false;
+    }
+
+    const uint64_t End = Seen_;
+    const uint64_t Middle = End - Period;
+    const uint64_t Begin = Middle - Period;
+    if (WindowHash(Begin, Middle) != WindowHash(Middle, End)) {
+      return false;
+    }
+
+    for (uint64_t Idx = 0; Idx < Period; Idx++) {
+      if (Address(Begin + Idx) != Address(Middle + Idx)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+public:
+  explicit LoopFolder_t(const uint64_t MaxPeriod) : MaxPeriod_(MaxPeriod) {
+    uint64_t RingSize = 1;
+    while (RingSize < (2 * MaxPeriod_) + GramSize + 1) {
+      RingSize *= 2;
+    }
+
+    Addresses_.resize(RingSize);
+    Hashes_.resize(RingSize);
+    Mask_ = RingSize - 1;
+    Powers_.resize(std::max(2 * MaxPeriod_, GramSize) + 1);
+    Powers_[0] = 1;
+    for (size_t Idx = 1; Idx < Powers_.size(); Idx++) {
+      Powers_[Idx] = Powers_[Idx - 1] * HashBase;
+    }
+
+    LastSeen_.resize(1ULL << TableBits);
+    Pending_.resize(MaxPeriod_ + 1);
+  }
+
+  //
+  // Push the line of |Address| that was just written at |Begin| in |Buffer|;
+  // it is taken out of the buffer, and the lines that can't be part of a
+  // loop anymore are written back into it.
+  //
+
+  template <typename Buffer_t>
+  void Push(const uint64_t Address, Buffer_t &Buffer, const size_t Begin) {
+    Line_.assign(Buffer.data() + Begin, Buffer.data() + Buffer.size());
+    Buffer.resize(Begin);
+
+    const uint64_t Before = Seen_ == 0 ? 0 : Hashes_[(Seen_ - 1) & Mask_];
+    Addresses_[Seen_ & Mask_] = Address;
+    Hashes_[Seen_ & Mask_] = (Before * HashBase) + Address + 1;
+    Seen_++;
+
+    //
+    // Find out where the last few addresses were seen last; if we are in a
+    // loop, this is how long its body is.
+    //
+
+    uint64_t Period = 0;
+    if (Seen_ >= GramSize) {
+      const uint64_t Gram = WindowHash(Seen_ - GramSize, Seen_);
+      uint64_t &Last =
+          LastSeen_[(Gram * 0x9e3779b97f4a7c15) >> (64 - TableBits)];
+      Period = Last == 0 ? 0 : Seen_ - Last;
+      Last = Seen_;
+    }
+
+    //
+    // If we are in a loop, drop the iterations that go the same way as the
+    // first one.
+    //
+
+    if (Period_ != 0) {
+      if (Address == this->Address(Seen_ - 1 - Period_)) {
+        PushPending(Line_);
+        if (++Phase_ == Period_) {
+          Repeats_++;
+          Phase_ = 0;
+          PendingSize_ = 0;
+        }
+
+        return;
+      }
+
+      EndLoop(Buffer);
+    }
+
+    PushPending(Line_);
+    RunLength_++;
+
+    //
+    // If the line ends the second iteration of a loop, drop that iteration
+    // and write what is before it out.
+    //
+
+    if (IsLoop(Period)) {
+      PendingSize_ -= Period;
+      while (PendingSize_ > 0) {
+        EmitOldest(Buffer);
+      }
+
+      Period_ = Period;
+      Phase_ = 0;
+      Repeats_ = 1;
+      return;
+    }
+
+    while (PendingSize_ > MaxPeriod_) {
+      EmitOldest(Buffer);
+    }
+  }
+
+  //
+  // Write all the delayed lines out, ending the loop we are in if any.
+  //
+
+  template <typename Buffer_t> void Flush(Buffer_t &Buffer) {
+    if (Period_ != 0) {
+      EndLoop(Buffer);
+    }
+
+    while (PendingSize_ > 0) {
+      EmitOldest(Buffer);
+    }
+
+    RunLength_ = 0;
+  }
+
+  uint64_t Folded() const { return Folded_; }
+};
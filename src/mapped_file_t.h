@@ -0,0 +1,399 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+//
+// How the views of a file are going to be used, which decides of the hints
+// given to the kernel.
+//
+
+struct MapHints_t {
+
+  //
+  // Fault the pages of a view in when it gets mapped (MAP_POPULATE) instead of
+  // taking a page fault on their first touch.
+  //
+
+  bool Populate = true;
+
+  //
+  // Back the views with transparent huge pages. This only is a hint: file
+  // backed mappings only get them if the kernel supports it for the
+  // filesystem, the views read in memory always can.
+  //
+
+  bool HugePages = false;
+
+  //
+  // The views are walked front to back; the kernel reads ahead more
+  // aggressively and drops the pages behind sooner.
+  //
+
+  bool Sequential = true;
+
+  //
+  // Drop the parts of the file that have been walked from the page cache.
+  // This is to be turned off when the file gets walked more than once.
+  //
+
+  bool DropBehind = true;
+};
+
+//
+// A view of a file; either mapped, or read in memory when the file can't be
+// mapped.
+//
+
+struct MappedView_t {
+  const char *Base = nullptr;
+  uint64_t Offset = 0;
+  uint64_t Size = 0;
+  bool Read = false;
+};
+
+//
+// This maps views of a file in memory. When the file can't be mapped (some
+// network or virtual filesystems don't support it), the views are read in
+// memory instead so that the rest of the code doesn't have to care.
+//
+
+class MappedFile_t {
+#if defined(_WIN32)
+  HANDLE File_ = INVALID_HANDLE_VALUE;
+  HANDLE Mapping_ = nullptr;
+#else
+  int Fd_ = -1;
+#endif
+
+  std::string Path_;
+  uint64_t Size_ = 0;
+  uint64_t Granularity_ = 0;
+  MapHints_t Hints_;
+
+  //
+  // Is the file mappable; this gets turned off the first time mapping it
+  // fails.
+  //
+
+  bool Mappable_ = true;
+
+public:
+  MappedFile_t() = default;
+  ~MappedFile_t() {
+#if defined(_WIN32)
+    if (Mapping_ != nullptr) {
+      CloseHandle(Mapping_);
+    }
+
+    if (File_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(File_);
+    }
+#else
+    if (Fd_ != -1) {
+      close(Fd_);
+    }
+#endif
+  }
+
+  //
+  // Rule of three.
+  //
+
+  MappedFile_t(const MappedFile_t &) = delete;
+  MappedFile_t &operator=(MappedFile_t &) = delete;
+
+  //
+  // Open the file at |Path|; its views will be mapped according to |Hints|.
+  //
+
+  bool Open(const fs::path &Path, const MapHints_t &Hints = {}) {
+    Path_ = Path.string();
+    Hints_ = Hints;
+#if defined(_WIN32)
+    const DWORD Flags =
+        Hints.Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+    File_ = CreateFileA(Path_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, Flags, nullptr);
+    if (File_ == INVALID_HANDLE_VALUE) {
+      fmt::print("Could not open input {}\n", Path_);
+      return false;
+    }
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(File_, &FileSize)) {
+      fmt::print("Could not get the size of {}\n", Path_);
+      return false;
+    }
+
+    Size_ = FileSize.QuadPart;
+
+    //
+    // Empty files can't be mapped, but there is nothing to map anyway.
+    //
+
+    if (Size_ > 0) {
+      Mapping_ =
+          CreateFileMappingA(File_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      Mappable_ = Mapping_ != nullptr;
+      if (!Mappable_) {
+        fmt::print("Could not map {}, reading it instead\n", Path_);
+      }
+    }
+
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    Granularity_ = SystemInfo.dwAllocationGranularity;
+#else
+    Fd_ = open(Path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (Fd_ == -1) {
+      fmt::print("Could not open input {}\n", Path_);
+      return false;
+    }
+
+    struct stat Stat;
+    if (fstat(Fd_, &Stat) != 0) {
+      fmt::print("Could not get the size of {}\n", Path_);
+      return false;
+    }
+
+    Size_ = Stat.st_size;
+    Granularity_ = sysconf(_SC_PAGESIZE);
+    if (Hints.Sequential) {
+      posix_fadvise(Fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#endif
+
+    return true;
+  }
+
+  uint64_t Size() const { return Size_; }
+
+  //
+  // Views have to start at an offset aligned on the granularity.
+  //
+
+  uint64_t Granularity() const { return Granularity_; }
+
+  //
+  // Map |Size| bytes of the file starting at |Offset| into |View|.
+  //
+
+  bool Map(const uint64_t Offset, const uint64_t Size, MappedView_t &View) {
+    if (Mappable_) {
+      if (MapView(Offset, Size, View)) {
+        return true;
+      }
+
+      if (Mappable_) {
+        return false;
+      }
+
+      fmt::print("Could not map {}, reading it instead\n", Path_);
+    }
+
+    return ReadView(Offset, Size, View);
+  }
+
+  void Unmap(MappedView_t &View) {
+    if (View.Base == nullptr) {
+      return;
+    }
+
+#if defined(_WIN32)
+    if (View.Read) {
+      VirtualFree((LPVOID)View.Base, 0, MEM_RELEASE);
+    } else {
+      UnmapViewOfFile(View.Base);
+    }
+#else
+    munmap((void *)View.Base, View.Size);
+#endif
+    View = {};
+  }
+
+  //
+  // Let the kernel know that [|Offset|, |Offset| + |Size|) will be needed
+  // soon, so that it starts reading it in the background.
+  //
+
+  void ReadAhead(const uint64_t Offset, const uint64_t Size) {
+#if !defined(_WIN32)
+    posix_fadvise(Fd_, Offset, Size, POSIX_FADV_WILLNEED);
+#else
+    static_cast<void>(Offset);
+    static_cast<void>(Size);
+#endif
+  }
+
+  //
+  // Drop the pages of [|Offset|, |Offset| + |Size|) from the page cache as
+  // they won't be needed anymore. There is no such thing on Windows, where
+  // unmapping the views is all we can do.
+  //
+
+  void DropPages(const uint64_t Offset, const uint64_t Size) {
+#if !defined(_WIN32)
+    posix_fadvise(Fd_, Offset, Size, POSIX_FADV_DONTNEED);
+#else
+    static_cast<void>(Offset);
+    static_cast<void>(Size);
+#endif
+  }
+
+private:
+  //
+  // Map a view of the file. If the file turns out not to be mappable,
+  // |Mappable_| gets turned off.
+  //
+
+  bool MapView(const uint64_t Offset, const uint64_t Size, MappedView_t &View) {
+#if defined(_WIN32)
+    void *Base = MapViewOfFile(Mapping_, FILE_MAP_READ, DWORD(Offset >> 32),
+                               DWORD(Offset), SIZE_T(Size));
+    if (Base == nullptr) {
+      fmt::print("Could not map the view at {:#x}\n", Offset);
+      return false;
+    }
+
+    //
+    // There is no MAP_POPULATE on Windows, but the closest is to ask for the
+    // pages to be brought in with large reads instead of one fault at a time.
+    //
+
+    if (Hints_.Populate) {
+      WIN32_MEMORY_RANGE_ENTRY Range;
+      Range.VirtualAddress = Base;
+      Range.NumberOfBytes = SIZE_T(Size);
+      PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+    }
+#else
+    int Flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    if (Hints_.Populate) {
+      Flags |= MAP_POPULATE;
+    }
+#endif
+
+    void *Base = mmap(nullptr, Size, PROT_READ, Flags, Fd_, Offset);
+    if (Base == MAP_FAILED) {
+
+      //
+      // Running out of address space isn't something reading the file
+      // instead would fix.
+      //
+
+      if (errno == ENOMEM) {
+        fmt::print("Could not map the view at {:#x}\n", Offset);
+      } else {
+        Mappable_ = false;
+      }
+
+      return false;
+    }
+
+    Advise(Base, Size);
+    if (!Hints_.Populate) {
+      madvise(Base, Size, MADV_WILLNEED);
+    }
+#endif
+
+    View = MappedView_t{(const char *)Base, Offset, Size, false};
+    return true;
+  }
+
+  //
+  // Read a view of the file in memory.
+  //
+
+  bool ReadView(const uint64_t Offset, const uint64_t Size,
+                MappedView_t &View) {
+#if defined(_WIN32)
+    char *Base = (char *)VirtualAlloc(nullptr, SIZE_T(Size),
+                                      MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (Base == nullptr) {
+      fmt::print("Could not allocate the view at {:#x}\n", Offset);
+      return false;
+    }
+#else
+    void *Memory = mmap(nullptr, Size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Memory == MAP_FAILED) {
+      fmt::print("Could not allocate the view at {:#x}\n", Offset);
+      return false;
+    }
+
+    char *Base = (char *)Memory;
+    Advise(Base, Size);
+#endif
+
+    //
+    // A single read can't be larger than 4GB on Windows, and is capped at 2GB
+    // on Linux.
+    //
+
+    constexpr uint64_t MaxReadSize = 1'024 * 1'024 * 1'024;
+    View = MappedView_t{Base, Offset, Size, true};
+    uint64_t Done = 0;
+    while (Done < Size) {
+      const uint64_t Left = std::min<uint64_t>(Size - Done, MaxReadSize);
+#if defined(_WIN32)
+      OVERLAPPED Overlapped = {};
+      Overlapped.Offset = DWORD(Offset + Done);
+      Overlapped.OffsetHigh = DWORD((Offset + Done) >> 32);
+      DWORD Read = 0;
+      if (!ReadFile(File_, Base + Done, DWORD(Left), &Read, &Overlapped)) {
+        Read = 0;
+      }
+#else
+      const ssize_t Read = pread(Fd_, Base + Done, Left, Offset + Done);
+      if (Read < 0 && errno == EINTR) {
+        continue;
+      }
+#endif
+
+      if (Read <= 0) {
+        fmt::print("Could not read the view at {:#x}\n", Offset + Done);
+        Unmap(View);
+        return false;
+      }
+
+      Done += Read;
+    }
+
+    return true;
+  }
+
+#if !defined(_WIN32)
+  //
+  // Pass the hints that apply to a view once it is in memory.
+  //
+
+  void Advise(void *Base, const uint64_t Size) const {
+    if (Hints_.Sequential) {
+      madvise(Base, Size, MADV_SEQUENTIAL);
+    }
+
+#if defined(MADV_HUGEPAGE)
+    if (Hints_.HugePages) {
+      madvise(Base, Size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+#endif
+};
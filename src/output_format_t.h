@@ -0,0 +1,349 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "utils.h"
+#include <cstdint>
+#include <cstring>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//
+// What the symbol backends know about an address: the module it belongs to
+// and where the module is loaded, and the closest symbol before the address.
+// When there is no such symbol, |Symbol| is empty and |Displacement| is the
+// offset of the address in the module.
+//
+
+struct SymbolInfo_t {
+  std::string Module;
+  uint64_t ModuleBase = 0;
+  std::string Symbol;
+  uint64_t Displacement = 0;
+};
+
+//
+// This is an output format defined by the user, such as
+// `{addr:x} {mod}!{sym}+{disp:x}`. The fields are:
+//   - addr: the address,
+//   - mod, base, off: the module, its base and the offset of the address in
+//   it,
+//   - sym, disp: the symbol and the displacement of the address from it,
+//   - line: the line number of the address in the trace.
+// The numbers are in decimal, or in hexadecimal with `:x` (`:#x` adds the 0x
+// prefix), and `:json` escapes the strings for JSON. `{{` and `}}` are literal
+// braces.
+//
+// The format is compiled once into a list of operations. Everything but the
+// line numbers only depends on the address, so that part is rendered once
+// per address by |Render| and gets cached just like the built-in styles; for
+// every line, |Append| only has to splice the line numbers in, if there are
+// any.
+//
+
+class OutputFormat_t {
+  enum class Field_t {
+    Literal,
+    Address,
+    Module,
+    ModuleBase,
+    Offset,
+    Symbol,
+    Displacement,
+    LineNumber
+  };
+
+  enum class Base_t { Decimal, Hex, PrefixedHex };
+
+  struct Op_t {
+    Field_t Field = Field_t::Literal;
+    Base_t Base = Base_t::Decimal;
+    bool Json = false;
+    std::string Literal;
+  };
+
+  std::vector<Op_t> Ops_;
+
+  //
+  // The bases of the line number fields, in order.
+  //
+
+  std::vector<Base_t> LineNumbers_;
+
+public:
+  //
+  // A rendered symbol holds this character where a line number goes.
+  //
+
+  static constexpr char LineMarker = '\0';
+
+  //
+  // The output format of --style jsonl: one JSON object per line. The
+  // addresses are strings as they don't fit in the doubles a lot of JSON
+  // parsers use for numbers.
+  //
+
+  static constexpr std::string_view Jsonl =
+      R"({{"addr":"{addr:#x}","module":"{mod:json}","base":"{base:#x}",)"
+      R"("symbol":"{sym:json}","displacement":{disp},"line":{line}}})";
+
+  //
+  // Compile |Format|; this returns false if it is malformed.
+  //
+
+  bool Compile(const std::string_view Format) {
+    Ops_.clear();
+    LineNumbers_.clear();
+    std::string Literal;
+    const auto &FlushLiteral = [&]() {
+      if (!Literal.empty()) {
+        Ops_.emplace_back(
+            Op_t{Field_t::Literal, Base_t::Decimal, false, Literal});
+        Literal.clear();
+      }
+    };
+
+    for (size_t Idx = 0; Idx < Format.size(); Idx++) {
+      const char C = Format[Idx];
+      if (C == '}') {
+        if (Idx + 1 == Format.size() || Format[Idx + 1] != '}') {
+          fmt::print("Unmatched '}}' in the output format\n");
+          return false;
+        }
+
+        Literal += '}';
+        Idx++;
+        continue;
+      }
+
+      if (C != '{') {
+        Literal += C;
+        continue;
+      }
+
+      if (Idx + 1 < Format.size() && Format[Idx + 1] == '{') {
+        Literal += '{';
+        Idx++;
+        continue;
+      }
+
+      const size_t Close = Format.find('}', Idx);
+      if (Close == Format.npos) {
+        fmt::print("Unterminated field in the output format\n");
+        return false;
+      }
+
+      Op_t Op;
+      if (!ParseField(Format.substr(Idx + 1, Close - Idx - 1), Op)) {
+        return false;
+      }
+
+      FlushLiteral();
+      if (Op.Field == Field_t::LineNumber) {
+        LineNumbers_.emplace_back(Op.Base);
+      }
+
+      Ops_.emplace_back(std::move(Op));
+      Idx = Close;
+    }
+
+    FlushLiteral();
+    return true;
+  }
+
+  bool Empty() const { return Ops_.empty(); }
+  bool HasLineNumbers() const { return !LineNumbers_.empty(); }
+
+  //
+  // Render the part of the output line of |Address| that doesn't depend on
+  // the line.
+  //
+
+  std::string Render(const uint64_t Address, const SymbolInfo_t &Info) const {
+    fmt::memory_buffer Buffer;
+    auto Out = std::back_inserter(Buffer);
+    for (const Op_t &Op : Ops_) {
+      switch (Op.Field) {
+      case Field_t::Literal: {
+        Buffer.append(Op.Literal.data(), Op.Literal.data() + Op.Literal.size());
+        break;
+      }
+
+      case Field_t::Address: {
+        AppendNumber(Out, Op.Base, Address);
+        break;
+      }
+
+      case Field_t::Module: {
+        AppendString(Buffer, Op.Json, Info.Module);
+        break;
+      }
+
+      case Field_t::ModuleBase: {
+        AppendNumber(Out, Op.Base, Info.ModuleBase);
+        break;
+      }
+
+      case Field_t::Offset: {
+        AppendNumber(Out, Op.Base, Address - Info.ModuleBase);
+        break;
+      }
+
+      case Field_t::Symbol: {
+        AppendString(Buffer, Op.Json, Info.Symbol);
+        break;
+      }
+
+      case Field_t::Displacement: {
+        AppendNumber(Out, Op.Base, Info.Displacement);
+        break;
+      }
+
+      case Field_t::LineNumber: {
+        Buffer.push_back(LineMarker);
+        break;
+      }
+      }
+    }
+
+    return fmt::to_string(Buffer);
+  }
+
+  //
+  // Append the output line at |LineNumber| of the address that got rendered
+  // into |Rendered|; |Suffix| goes right before the end of the line.
+  //
+
+  template <typename Buffer_t>
+  void Append(Buffer_t &Buffer, const uint64_t LineNumber,
+              const std::string_view Rendered,
+              const std::string_view Suffix = {}) const {
+    auto Out = std::back_inserter(Buffer);
+    const char *Current = Rendered.data();
+    const char *End = Current + Rendered.size();
+    for (const Base_t Base : LineNumbers_) {
+      const char *Marker =
+          (const char *)memchr(Current, LineMarker, End - Current);
+      Buffer.append(Current, Marker);
+      AppendNumber(Out, Base, LineNumber);
+      Current = Marker + 1;
+    }
+
+    Buffer.append(Current, End);
+    Buffer.append(Suffix.data(), Suffix.data() + Suffix.size());
+    Buffer.push_back('\n');
+  }
+
+  //
+  // Returns the size of the output line |Append| would produce.
+  //
+
+  uint64_t Size(const uint64_t LineNumber,
+                const std::string_view Rendered) const {
+    uint64_t Size = Rendered.size() - LineNumbers_.size() + 1;
+    for (const Base_t Base : LineNumbers_) {
+      Size += NumberSize(Base, LineNumber);
+    }
+
+    return Size;
+  }
+
+private:
+  bool ParseField(const std::string_view Field, Op_t &Op) {
+    const size_t Colon = Field.find(':');
+    const std::string_view Name = Field.substr(0, Colon);
+    const std::string_view Spec =
+        Colon == Field.npos ? std::string_view() : Field.substr(Colon + 1);
+
+    bool Numeric = true;
+    if (Name == "addr") {
+      Op.Field = Field_t::Address;
+    } else if (Name == "mod") {
+      Op.Field = Field_t::Module;
+      Numeric = false;
+    } else if (Name == "base") {
+      Op.Field = Field_t::ModuleBase;
+    } else if (Name == "off") {
+      Op.Field = Field_t::Offset;
+    } else if (Name == "sym") {
+      Op.Field = Field_t::Symbol;
+      Numeric = false;
+    } else if (Name == "disp") {
+      Op.Field = Field_t::Displacement;
+    } else if (Name == "line") {
+      Op.Field = Field_t::LineNumber;
+    } else {
+      fmt::print("Unknown field '{}' in the output format\n", Name);
+      return false;
+    }
+
+    if (Spec.empty()) {
+      return true;
+    }
+
+    if (!Numeric && Spec == "json") {
+      Op.Json = true;
+    } else if (Numeric && Spec == "x") {
+      Op.Base = Base_t::Hex;
+    } else if (Numeric && Spec == "#x") {
+      Op.Base = Base_t::PrefixedHex;
+    } else {
+      fmt::print("Unsupported format '{}' for the field '{}'\n", Spec, Name);
+      return false;
+    }
+
+    return true;
+  }
+
+  //
+  // Append |String| into |Buffer|, escaped for a JSON string if |Json| is
+  // set.
+  //
+
+  static void AppendString(fmt::memory_buffer &Buffer, const bool Json,
+                           const std::string_view String) {
+    if (!Json) {
+      Buffer.append(String.data(), String.data() + String.size());
+      return;
+    }
+
+    AppendJsonEscaped(Buffer, String);
+  }
+
+  template <typename Out_t>
+  static void AppendNumber(Out_t &Out, const Base_t Base,
+                           const uint64_t Number) {
+    switch (Base) {
+    case Base_t::Hex: {
+      Out = fmt::format_to(Out, "{:x}", Number);
+      break;
+    }
+
+    case Base_t::PrefixedHex: {
+      Out = fmt::format_to(Out, "{:#x}", Number);
+      break;
+    }
+
+    default: {
+      Out = fmt::format_to(Out, "{}", Number);
+      break;
+    }
+    }
+  }
+
+  static uint64_t NumberSize(const Base_t Base, const uint64_t Number) {
+    switch (Base) {
+    case Base_t::Hex: {
+      return fmt::formatted_size("{:x}", Number);
+    }
+
+    case Base_t::PrefixedHex: {
+      return fmt::formatted_size("{:#x}", Number);
+    }
+
+    default: {
+      return fmt::formatted_size("{}", Number);
+    }
+    }
+  }
+};
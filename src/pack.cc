@@ -0,0 +1,107 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#include "pack_t.h"
+#include <CLI/CLI.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string>
+
+namespace fs = std::filesystem;
+
+//
+// The command line options of the pack reader.
+//
+
+struct PackOpts_t {
+
+  //
+  // The pack to read.
+  //
+
+  fs::path Input;
+
+  //
+  // The name of the output to extract; the outputs are listed if empty.
+  //
+
+  std::string Name;
+
+  //
+  // Where the output gets extracted; stdout if empty.
+  //
+
+  fs::path Output;
+};
+
+PackOpts_t Opts;
+
+int main(int argc, char *argv[]) {
+
+  //
+  // Set up the argument parsing.
+  //
+
+  CLI::App Pack("Symbolizer pack reader - Lists the outputs of a pack written "
+                "with --pack, or extracts one of them");
+
+  Pack.allow_windows_style_options();
+  Pack.add_option("-i,--input", Opts.Input, "Input pack")
+      ->check(CLI::ExistingFile)
+      ->required();
+  Pack.add_option("-x,--extract", Opts.Name,
+                  "Name of the output to extract (default: list the outputs)");
+  Pack.add_option("-o,--output", Opts.Output,
+                  "Where to extract the output (default: stdout)");
+
+  CLI11_PARSE(Pack, argc, argv);
+
+  PackReader_t Reader;
+  if (!Reader.Open(Opts.Input)) {
+    return EXIT_FAILURE;
+  }
+
+  //
+  // List the outputs if we are not asked to extract one.
+  //
+
+  if (Opts.Name.empty()) {
+    for (const auto &Entry : Reader.Entries()) {
+      fmt::print("{} {}\n", Entry.Size(), Entry.Name);
+    }
+
+    return EXIT_SUCCESS;
+  }
+
+  const PackEntry_t *Entry = Reader.Find(Opts.Name);
+  if (Entry == nullptr) {
+    fmt::print("There is no output named {} in {}\n", Opts.Name,
+               Opts.Input.string());
+    return EXIT_FAILURE;
+  }
+
+  FILE *Output = Opts.Output.empty()
+                     ? stdout
+                     : fopen(Opts.Output.string().c_str(), "wb");
+  if (Output == nullptr) {
+    fmt::print("Could not create {}\n", Opts.Output.string());
+    return EXIT_FAILURE;
+  }
+
+  bool Written = true;
+  for (const auto &Extent : Entry->Extents) {
+    const std::string_view Data = Reader.Read(Extent);
+    Written = Written &&
+              fwrite(Data.data(), 1, Data.size(), Output) == Data.size();
+  }
+
+  if (Output != stdout) {
+    Written = fclose(Output) == 0 && Written;
+  }
+
+  if (!Written) {
+    fmt::print("Could not write {}\n", Opts.Output.string());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,283 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "mapped_file_t.h"
+#include "preallocated_file_t.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//
+// A pack is a single file holding the outputs of a batch, so that symbolizing
+// hundreds of thousands of traces doesn't create as many files. It looks like
+// this:
+//   - The magic,
+//   - The outputs, one after the other,
+//   - The index: for every output, its name (u32 size + bytes) and its
+//   extents (u32 count + u64 offset / u64 size pairs),
+//   - The trailer: the offset of the index, the number of outputs and the
+//   magic.
+// An output is made of one extent unless several were written at the same
+// time, in which case their extents interleave; reading it back is reading
+// its extents in order.
+//
+
+constexpr std::string_view PackMagic = "SYMPACK1";
+
+struct PackExtent_t {
+  uint64_t Offset = 0;
+  uint64_t Size = 0;
+};
+
+struct PackEntry_t {
+  std::string Name;
+  std::vector<PackExtent_t> Extents;
+
+  //
+  // Add the extent [|Offset|, |Offset| + |Size|), which gets merged with the
+  // last one if they are contiguous.
+  //
+
+  void Add(const uint64_t Offset, const uint64_t Size) {
+    if (Size == 0) {
+      return;
+    }
+
+    if (!Extents.empty() &&
+        (Extents.back().Offset + Extents.back().Size) == Offset) {
+      Extents.back().Size += Size;
+      return;
+    }
+
+    Extents.emplace_back(PackExtent_t{Offset, Size});
+  }
+
+  uint64_t Size() const {
+    uint64_t Size = 0;
+    for (const auto &Extent : Extents) {
+      Size += Extent.Size;
+    }
+
+    return Size;
+  }
+};
+
+//
+// This writes a pack. Appending space is a single atomic add on the end of
+// the pack and the data is written at its offset, so any number of threads
+// can append without waiting on each other; only the index is behind a lock,
+// which is taken once per output.
+//
+
+class PackWriter_t {
+  PreallocatedFile_t File_;
+  std::atomic<uint64_t> End_ = 0;
+  std::mutex Lock_;
+  std::vector<PackEntry_t> Entries_;
+
+public:
+  bool Open(const fs::path &Path) {
+    if (!File_.Open(Path, 0)) {
+      return false;
+    }
+
+    End_ = PackMagic.size();
+    return File_.WriteAt(0, PackMagic.data(), PackMagic.size());
+  }
+
+  //
+  // Reserve |Size| bytes at the end of the pack, and returns where they are.
+  //
+
+  uint64_t Reserve(const uint64_t Size) { return End_.fetch_add(Size); }
+
+  bool WriteAt(const uint64_t Offset, const char *Data, const size_t Size) {
+    return File_.WriteAt(Offset, Data, Size);
+  }
+
+  //
+  // Append |Size| bytes of |Data| to the output |Entry|.
+  //
+
+  bool Append(PackEntry_t &Entry, const char *Data, const size_t Size) {
+    const uint64_t Offset = Reserve(Size);
+    Entry.Add(Offset, Size);
+    return WriteAt(Offset, Data, Size);
+  }
+
+  //
+  // The output |Entry| is complete; add it to the index.
+  //
+
+  void Commit(PackEntry_t &&Entry) {
+    std::scoped_lock Guard(Lock_);
+    Entries_.emplace_back(std::move(Entry));
+  }
+
+  size_t NumberEntries() const { return Entries_.size(); }
+
+  //
+  // Write the index and the trailer out; nothing can be appended anymore.
+  //
+
+  bool Close() {
+    std::string Index;
+    const auto &Put = [&](const auto Value) {
+      Index.append((const char *)&Value, sizeof(Value));
+    };
+
+    for (const auto &Entry : Entries_) {
+      Put(uint32_t(Entry.Name.size()));
+      Index.append(Entry.Name);
+      Put(uint32_t(Entry.Extents.size()));
+      for (const auto &Extent : Entry.Extents) {
+        Put(Extent.Offset);
+        Put(Extent.Size);
+      }
+    }
+
+    const uint64_t IndexOffset = End_;
+    Put(IndexOffset);
+    Put(uint64_t(Entries_.size()));
+    Index.append(PackMagic);
+    return File_.WriteAt(IndexOffset, Index.data(), Index.size());
+  }
+};
+
+//
+// This reads a pack back; it is mapped whole, and the outputs are looked up
+// by name.
+//
+
+class PackReader_t {
+  MappedFile_t File_;
+  MappedView_t View_;
+  std::vector<PackEntry_t> Entries_;
+  std::unordered_map<std::string_view, size_t> Names_;
+
+public:
+  ~PackReader_t() { File_.Unmap(View_); }
+
+  bool Open(const fs::path &Path) {
+    MapHints_t Hints;
+    Hints.Sequential = false;
+    Hints.DropBehind = false;
+    if (!File_.Open(Path, Hints)) {
+      return false;
+    }
+
+    constexpr uint64_t TrailerSize = (2 * sizeof(uint64_t)) + PackMagic.size();
+    const uint64_t Size = File_.Size();
+    if (Size < PackMagic.size() + TrailerSize ||
+        !File_.Map(0, Size, View_) ||
+        memcmp(View_.Base, PackMagic.data(), PackMagic.size()) != 0 ||
+        memcmp(View_.Base + Size - PackMagic.size(), PackMagic.data(),
+               PackMagic.size()) != 0) {
+      fmt::print("{} is not a pack\n", Path.string());
+      return false;
+    }
+
+    //
+    // Walk the index; every read is checked against its end as the pack
+    // might be truncated or corrupted.
+    //
+
+    const char *Current = View_.Base + Size - TrailerSize;
+    const char *End = Current;
+    uint64_t IndexOffset = 0;
+    uint64_t NumberEntries = 0;
+    memcpy(&IndexOffset, Current, sizeof(IndexOffset));
+    memcpy(&NumberEntries, Current + sizeof(IndexOffset),
+           sizeof(NumberEntries));
+    if (IndexOffset > Size - TrailerSize) {
+      fmt::print("The index of {} is corrupted\n", Path.string());
+      return false;
+    }
+
+    Current = View_.Base + IndexOffset;
+    const auto &Get = [&](auto &Value) {
+      if (uint64_t(End - Current) < sizeof(Value)) {
+        return false;
+      }
+
+      memcpy(&Value, Current, sizeof(Value));
+      Current += sizeof(Value);
+      return true;
+    };
+
+    //
+    // The counts are checked against what is left of the index before
+    // anything gets allocated for them: an entry takes at least its name
+    // size and its extent count, and an extent its offset and size.
+    //
+
+    constexpr uint64_t MinEntrySize = 2 * sizeof(uint32_t);
+    constexpr uint64_t ExtentSize = 2 * sizeof(uint64_t);
+    if (NumberEntries > uint64_t(End - Current) / MinEntrySize) {
+      fmt::print("The index of {} is corrupted\n", Path.string());
+      return false;
+    }
+
+    Entries_.resize(NumberEntries);
+    for (auto &Entry : Entries_) {
+      uint32_t NameSize = 0;
+      uint32_t NumberExtents = 0;
+      if (!Get(NameSize) || uint64_t(End - Current) < NameSize) {
+        fmt::print("The index of {} is corrupted\n", Path.string());
+        return false;
+      }
+
+      Entry.Name.assign(Current, NameSize);
+      Current += NameSize;
+      if (!Get(NumberExtents) ||
+          NumberExtents > uint64_t(End - Current) / ExtentSize) {
+        fmt::print("The index of {} is corrupted\n", Path.string());
+        return false;
+      }
+
+      Entry.Extents.resize(NumberExtents);
+      for (auto &Extent : Entry.Extents) {
+        if (!Get(Extent.Offset) || !Get(Extent.Size) ||
+            Extent.Offset > IndexOffset ||
+            Extent.Size > IndexOffset - Extent.Offset) {
+          fmt::print("The index of {} is corrupted\n", Path.string());
+          return false;
+        }
+      }
+    }
+
+    for (size_t Idx = 0; Idx < Entries_.size(); Idx++) {
+      Names_.emplace(Entries_[Idx].Name, Idx);
+    }
+
+    return true;
+  }
+
+  const std::vector<PackEntry_t> &Entries() const { return Entries_; }
+
+  //
+  // Returns the output named |Name| if there is one.
+  //
+
+  const PackEntry_t *Find(const std::string_view Name) const {
+    const auto &It = Names_.find(Name);
+    return It == Names_.end() ? nullptr : &Entries_[It->second];
+  }
+
+  //
+  // Returns the bytes of the extent |Extent| of an output.
+  //
+
+  std::string_view Read(const PackExtent_t &Extent) const {
+    return std::string_view(View_.Base + Extent.Offset, Extent.Size);
+  }
+};
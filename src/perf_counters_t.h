@@ -0,0 +1,215 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fmt/format.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//
+// The stages of the symbolization the counters are attributed to.
+//
+
+enum class Stage_t : size_t { Parse, Symbolize, Format, Write, Count };
+
+//
+// This samples the hardware performance counters of the calling thread and
+// attributes them to the stages of the symbolization: every call to |Lap|
+// reads the counters and accounts what happened since the previous call to a
+// stage. The counters are opened as a single group so that they get scheduled
+// together and read with a single syscall. Counters that can't be opened are
+// left out, and if none can (no PMU in a VM or a container, a restrictive
+// perf_event_paranoid, not Linux..), |Init| fails and the symbolization runs
+// without them.
+//
+
+class PerfCounters_t {
+public:
+  enum class Event_t : size_t {
+    Cycles,
+    Instructions,
+    CacheMisses,
+    BranchMisses,
+    DtlbMisses,
+    Count
+  };
+
+  static constexpr size_t NumberEvents = size_t(Event_t::Count);
+  static constexpr size_t NumberStages = size_t(Stage_t::Count);
+  using Values_t = std::array<uint64_t, NumberEvents>;
+
+private:
+  //
+  // The file descriptor of every event, -1 if it couldn't be opened; the
+  // first one opened leads the group.
+  //
+
+  std::array<int, NumberEvents> Fds_;
+  int Leader_ = -1;
+
+  //
+  // The values read last, and the totals of every stage.
+  //
+
+  Values_t Last_ = {};
+  std::array<Values_t, NumberStages> Totals_ = {};
+
+public:
+  PerfCounters_t() { Fds_.fill(-1); }
+
+  ~PerfCounters_t() {
+#if defined(__linux__)
+    for (const int Fd : Fds_) {
+      if (Fd != -1) {
+        close(Fd);
+      }
+    }
+#endif
+  }
+
+  //
+  // Rule of three.
+  //
+
+  PerfCounters_t(const PerfCounters_t &) = delete;
+  PerfCounters_t &operator=(PerfCounters_t &) = delete;
+
+  //
+  // Open the counters and start counting.
+  //
+
+  bool Init() {
+#if defined(__linux__)
+    constexpr std::array<std::pair<uint32_t, uint64_t>, NumberEvents> Events =
+        {{{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+          {PERF_TYPE_HW_CACHE,
+           PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}}};
+
+    for (size_t Idx = 0; Idx < NumberEvents; Idx++) {
+      perf_event_attr Attr;
+      memset(&Attr, 0, sizeof(Attr));
+      Attr.size = sizeof(Attr);
+      Attr.type = Events[Idx].first;
+      Attr.config = Events[Idx].second;
+      Attr.read_format = PERF_FORMAT_GROUP;
+      Attr.disabled = Leader_ == -1;
+      Attr.exclude_kernel = 1;
+      Attr.exclude_hv = 1;
+      Fds_[Idx] = int(syscall(SYS_perf_event_open, &Attr, 0, -1, Leader_, 0));
+      if (Fds_[Idx] != -1 && Leader_ == -1) {
+        Leader_ = Fds_[Idx];
+      }
+    }
+
+    if (Leader_ == -1) {
+      fmt::print("The hardware performance counters are unavailable "
+                 "(errno={}), skipping them\n",
+                 errno);
+      return false;
+    }
+
+    ioctl(Leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(Leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    Last_ = Read();
+    return true;
+#else
+    fmt::print("The hardware performance counters are only supported on "
+               "Linux, skipping them\n");
+    return false;
+#endif
+  }
+
+  //
+  // Account what happened since the previous lap to |Stage|.
+  //
+
+  void Lap(const Stage_t Stage) {
+    const Values_t Now = Read();
+    Values_t &Totals = Totals_[size_t(Stage)];
+    for (size_t Idx = 0; Idx < NumberEvents; Idx++) {
+      Totals[Idx] += Now[Idx] - Last_[Idx];
+    }
+
+    Last_ = Now;
+  }
+
+  //
+  // Forget what happened since the previous lap.
+  //
+
+  void Skip() { Last_ = Read(); }
+
+  //
+  // Print the counters of every stage, normalized by the number of lines.
+  //
+
+  void Dump(const uint64_t NumberLines) const {
+    constexpr std::array<const char *, NumberStages> Stages = {
+        "parse", "lookup", "format", "write"};
+    constexpr std::array<const char *, NumberEvents> Names = {
+        "cycles", "instructions", "cache-misses", "branch-misses",
+        "dtlb-misses"};
+
+    const double Lines = double(std::max<uint64_t>(NumberLines, 1));
+    fmt::print("{:<8} {:>8}", "per line", "ipc");
+    for (size_t Idx = 0; Idx < NumberEvents; Idx++) {
+      if (Fds_[Idx] != -1) {
+        fmt::print(" {:>14}", Names[Idx]);
+      }
+    }
+
+    fmt::print("\n");
+    for (size_t Stage = 0; Stage < NumberStages; Stage++) {
+      const Values_t &Totals = Totals_[Stage];
+      const uint64_t Cycles = Totals[size_t(Event_t::Cycles)];
+      const uint64_t Instructions = Totals[size_t(Event_t::Instructions)];
+      const bool HasIpc =
+          Cycles > 0 && Fds_[size_t(Event_t::Instructions)] != -1;
+      fmt::print("{:<8} {:>8.2f}", Stages[Stage],
+                 HasIpc ? double(Instructions) / double(Cycles) : 0.);
+      for (size_t Idx = 0; Idx < NumberEvents; Idx++) {
+        if (Fds_[Idx] != -1) {
+          fmt::print(" {:>14.2f}", double(Totals[Idx]) / Lines);
+        }
+      }
+
+      fmt::print("\n");
+    }
+  }
+
+private:
+  //
+  // Read the counters of the group. The values come in the order the events
+  // were added to the group, which skips the ones that couldn't be opened.
+  //
+
+  Values_t Read() const {
+    Values_t Values = {};
+#if defined(__linux__)
+    std::array<uint64_t, NumberEvents + 1> Group = {};
+    if (read(Leader_, Group.data(), sizeof(Group)) <= 0) {
+      return Last_;
+    }
+
+    size_t Value = 1;
+    for (size_t Idx = 0; Idx < NumberEvents && Value <= Group[0]; Idx++) {
+      if (Fds_[Idx] != -1) {
+        Values[Idx] = Group[Value++];
+      }
+    }
+#endif
+    return Values;
+  }
+};
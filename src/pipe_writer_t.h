@@ -0,0 +1,116 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fmt/format.h>
+#include <utility>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+//
+// This writes buffers into a pipe without copying them: their pages are
+// handed over to the pipe with vmsplice, and the reader on the other end gets
+// them straight from our memory. The catch is that the memory must not be
+// touched once it has been gifted: the reader might still hold references to
+// the pages long after the pipe looks empty (splice and tee move them along
+// without copying). So a buffer is never reused once handed over; it is
+// swapped with a new one and unmapped, which leaves the pages to the kernel.
+//
+
+class PipeWriter_t {
+  int Fd_ = -1;
+  size_t Capacity_ = 0;
+
+public:
+  //
+  // Is |Fd| a pipe we can vmsplice into?
+  //
+
+  static bool IsPipe(const int Fd) {
+#if defined(__linux__)
+    struct stat Stat;
+    return fstat(Fd, &Stat) == 0 && S_ISFIFO(Stat.st_mode);
+#else
+    static_cast<void>(Fd);
+    return false;
+#endif
+  }
+
+  //
+  // Set up the writer for the pipe |Fd|, which gets handed buffers of about
+  // |FlushSize| bytes. The pipe is resized to that if possible so that
+  // handing a buffer over doesn't need to wait on the reader, and the buffers
+  // get room to go over it.
+  //
+
+  bool Init(const int Fd, OutputBuffer_t &Buffer, const size_t FlushSize) {
+#if defined(__linux__)
+    Fd_ = Fd;
+    fcntl(Fd_, F_SETPIPE_SZ, int(FlushSize));
+    const int PipeSize = fcntl(Fd_, F_GETPIPE_SZ);
+    if (PipeSize <= 0) {
+      return false;
+    }
+
+    Capacity_ = 2 * std::max(FlushSize, size_t(PipeSize));
+    Buffer.reserve(Capacity_);
+    return true;
+#else
+    static_cast<void>(Fd);
+    static_cast<void>(Buffer);
+    static_cast<void>(FlushSize);
+    return false;
+#endif
+  }
+
+  //
+  // Hand |Buffer| over to the pipe and swap it with a new, empty, buffer. If
+  // the pipe doesn't take it, what is left is written out the usual way and
+  // false is returned.
+  //
+
+  bool Write(OutputBuffer_t &Buffer) {
+#if defined(__linux__)
+    bool Gifted = true;
+    size_t Written = 0;
+    while (Written < Buffer.size()) {
+      iovec Iovec = {Buffer.data() + Written, Buffer.size() - Written};
+      const ssize_t Amount =
+          Gifted ? vmsplice(Fd_, &Iovec, 1, SPLICE_F_GIFT)
+                 : write(Fd_, Iovec.iov_base, Iovec.iov_len);
+      if (Amount < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (Amount > 0) {
+        Written += size_t(Amount);
+      } else if (Gifted) {
+        Gifted = false;
+      } else {
+        break;
+      }
+    }
+
+    //
+    // The pages that were gifted belong to the pipe now; they get unmapped
+    // along with the buffer, which doesn't take them away from the kernel.
+    //
+
+    OutputBuffer_t Fresh;
+    Fresh.reserve(Capacity_);
+    std::swap(Buffer, Fresh);
+    return Gifted;
+#else
+    static_cast<void>(Buffer);
+    return false;
+#endif
+  }
+};
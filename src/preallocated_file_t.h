@@ -0,0 +1,142 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+//
+// This is an output file whose size is known before it gets written: it is
+// preallocated in one go, and then every part of it can be written at its
+// offset by a different thread without any of them waiting on the others.
+//
+
+class PreallocatedFile_t {
+#if defined(_WIN32)
+  HANDLE File_ = INVALID_HANDLE_VALUE;
+#else
+  int Fd_ = -1;
+#endif
+
+  std::string Path_;
+
+public:
+  PreallocatedFile_t() = default;
+  ~PreallocatedFile_t() {
+#if defined(_WIN32)
+    if (File_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(File_);
+    }
+#else
+    if (Fd_ != -1) {
+      close(Fd_);
+    }
+#endif
+  }
+
+  //
+  // Rule of three.
+  //
+
+  PreallocatedFile_t(const PreallocatedFile_t &) = delete;
+  PreallocatedFile_t &operator=(PreallocatedFile_t &) = delete;
+
+  //
+  // Create (or truncate) the file at |Path| and make it |Size| bytes large.
+  //
+
+  bool Open(const fs::path &Path, const uint64_t Size) {
+    Path_ = Path.string();
+#if defined(_WIN32)
+    File_ = CreateFileA(Path_.c_str(), GENERIC_WRITE, 0, nullptr,
+                        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (File_ == INVALID_HANDLE_VALUE) {
+      fmt::print("Could not open output {}\n", Path_);
+      return false;
+    }
+
+    LARGE_INTEGER End;
+    End.QuadPart = LONGLONG(Size);
+    if (!SetFilePointerEx(File_, End, nullptr, FILE_BEGIN) ||
+        !SetEndOfFile(File_)) {
+      fmt::print("Could not preallocate {} bytes for {}\n", Size, Path_);
+      return false;
+    }
+#else
+    Fd_ = open(Path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (Fd_ == -1) {
+      fmt::print("Could not open output {}\n", Path_);
+      return false;
+    }
+
+    if (Size == 0) {
+      return true;
+    }
+
+    //
+    // Reserve the blocks up front so that running out of space is noticed
+    // now and not halfway through; not every filesystem supports it, in which
+    // case the file is only extended.
+    //
+
+#if defined(__linux__)
+    if (posix_fallocate(Fd_, 0, off_t(Size)) == 0) {
+      return true;
+    }
+#endif
+
+    if (ftruncate(Fd_, off_t(Size)) != 0) {
+      fmt::print("Could not preallocate {} bytes for {}\n", Size, Path_);
+      return false;
+    }
+#endif
+
+    return true;
+  }
+
+  //
+  // Write |Size| bytes of |Data| at |Offset|; this can be called by several
+  // threads at once, as long as they write different parts of the file.
+  //
+
+  bool WriteAt(const uint64_t Offset, const char *Data, const size_t Size) {
+    size_t Written = 0;
+    while (Written < Size) {
+#if defined(_WIN32)
+      OVERLAPPED Overlapped = {};
+      Overlapped.Offset = DWORD(Offset + Written);
+      Overlapped.OffsetHigh = DWORD((Offset + Written) >> 32);
+      DWORD Amount = 0;
+      if (!WriteFile(File_, Data + Written, DWORD(Size - Written), &Amount,
+                     &Overlapped)) {
+        Amount = 0;
+      }
+#else
+      const ssize_t Amount =
+          pwrite(Fd_, Data + Written, Size - Written, off_t(Offset + Written));
+      if (Amount < 0 && errno == EINTR) {
+        continue;
+      }
+#endif
+
+      if (Amount <= 0) {
+        fmt::print("Could not write {} at {:#x}\n", Path_, Offset + Written);
+        return false;
+      }
+
+      Written += Amount;
+    }
+
+    return true;
+  }
+};
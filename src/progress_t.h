@@ -0,0 +1,164 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fmt/format.h>
+#include <mutex>
+#include <thread>
+
+//
+// This reports the progress of a run every |Interval| from a background
+// thread. The symbolization publishes its counters once per batch of lines
+// with relaxed atomics, and the reporter thread is the only one doing any
+// maths or printing.
+//
+
+class Progress_t {
+  //
+  // The bytes of the files already processed, and the bytes consumed in the
+  // file being processed.
+  //
+
+  std::atomic<uint64_t> BytesDone_ = 0;
+  std::atomic<uint64_t> BytesCurrent_ = 0;
+
+  //
+  // The lines symbolized, the files processed and the address cache stats.
+  //
+
+  std::atomic<uint64_t> Lines_ = 0;
+  std::atomic<uint64_t> Files_ = 0;
+  std::atomic<uint64_t> CacheHits_ = 0;
+  std::atomic<uint64_t> CacheMisses_ = 0;
+
+  //
+  // What the run has to process overall.
+  //
+
+  uint64_t TotalBytes_ = 0;
+  uint64_t TotalFiles_ = 0;
+
+  //
+  // The reporter thread and what is needed to stop it.
+  //
+
+  chrono::milliseconds Interval_;
+  chrono::steady_clock::time_point Start_;
+  std::thread Thread_;
+  std::mutex Lock_;
+  std::condition_variable Cv_;
+  bool Stop_ = false;
+
+public:
+  explicit Progress_t(const uint64_t TotalBytes, const uint64_t TotalFiles,
+                      const chrono::milliseconds Interval)
+      : TotalBytes_(TotalBytes), TotalFiles_(TotalFiles), Interval_(Interval) {
+  }
+
+  ~Progress_t() { Stop(); }
+
+  //
+  // Rule of three.
+  //
+
+  Progress_t(const Progress_t &) = delete;
+  Progress_t &operator=(Progress_t &) = delete;
+
+  //
+  // Start the reporter thread.
+  //
+
+  void Start() {
+    Start_ = chrono::steady_clock::now();
+    Thread_ = std::thread([this] {
+      std::unique_lock Lock(Lock_);
+      while (!Cv_.wait_for(Lock, Interval_, [this] { return Stop_; })) {
+        Report();
+      }
+    });
+  }
+
+  //
+  // Stop the reporter thread and print the final progress.
+  //
+
+  void Stop() {
+    if (!Thread_.joinable()) {
+      return;
+    }
+
+    {
+      std::scoped_lock Lock(Lock_);
+      Stop_ = true;
+    }
+
+    Cv_.notify_one();
+    Thread_.join();
+    Report();
+    fmt::print(stderr, "\n");
+  }
+
+  //
+  // Publish the progress made in the current file: the bytes consumed so far,
+  // the lines symbolized since the last call and the cache stats.
+  //
+
+  void Publish(const uint64_t BytesConsumed, const uint64_t NumberLines,
+               const uint64_t CacheHits, const uint64_t CacheMisses) {
+    BytesCurrent_.store(BytesConsumed, std::memory_order_relaxed);
+    Lines_.fetch_add(NumberLines, std::memory_order_relaxed);
+    CacheHits_.store(CacheHits, std::memory_order_relaxed);
+    CacheMisses_.store(CacheMisses, std::memory_order_relaxed);
+  }
+
+  //
+  // Account a file of |FileSize| bytes as done, even if --max made us stop
+  // before its end.
+  //
+
+  void FileDone(const uint64_t FileSize) {
+    BytesDone_.fetch_add(FileSize, std::memory_order_relaxed);
+    BytesCurrent_.store(0, std::memory_order_relaxed);
+    Files_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+private:
+  //
+  // Print a progress line.
+  //
+
+  void Report() const {
+    const uint64_t Bytes = BytesDone_.load(std::memory_order_relaxed) +
+                           BytesCurrent_.load(std::memory_order_relaxed);
+    const uint64_t Lines = Lines_.load(std::memory_order_relaxed);
+    const uint64_t Files = Files_.load(std::memory_order_relaxed);
+    const uint64_t Hits = CacheHits_.load(std::memory_order_relaxed);
+    const uint64_t Misses = CacheMisses_.load(std::memory_order_relaxed);
+    const double Seconds =
+        std::max(double(NanosecondsSince(Start_)) / 1'000'000'000, 1e-9);
+    const double BytesPerSecond = double(Bytes) / Seconds;
+    const double Percent =
+        TotalBytes_ > 0 ? (double(Bytes) * 100) / double(TotalBytes_) : 100.;
+    const double HitRate =
+        (Hits + Misses) > 0 ? (double(Hits) * 100) / double(Hits + Misses) : 0.;
+
+    //
+    // The ETA is extrapolated from the average byte throughput so far.
+    //
+
+    const uint64_t Left = TotalBytes_ > Bytes ? TotalBytes_ - Bytes : 0;
+    const chrono::seconds Eta(
+        BytesPerSecond > 0 ? uint64_t(double(Left) / BytesPerSecond) : 0);
+    fmt::print(stderr,
+               "\r[{} / {}] {:.1f}% {} lines, {}/s, {:.1f} MB/s, cache hit "
+               "rate {:.1f}%, ETA {}    ",
+               Files, TotalFiles_, Percent, NumberToHuman(Lines),
+               NumberToHuman(uint64_t(double(Lines) / Seconds)),
+               BytesPerSecond / (1'024 * 1'024), HitRate, SecondsToHuman(Eta));
+  }
+};
@@ -0,0 +1,399 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "io_ring_t.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+//
+// This reads a trace file block by block with io_uring, keeping several reads
+// in flight so that the symbolization doesn't wait on the disk. The blocks
+// are read into registered buffers, and every buffer has room for a block
+// worth of data in front of it: the record that straddles two blocks is
+// copied there, right before the block that follows, so that it is whole.
+//
+// As with the windows, the buffers a batch of records went through are only
+// recycled once the batch has been processed, when |Release| is called. If a
+// batch goes through all of them, a new (unregistered) buffer is added.
+//
+
+class RingTrace_t {
+public:
+  static constexpr uint32_t BlockSize = 1'024 * 1'024;
+  static constexpr size_t QueueDepth = 8;
+
+private:
+  struct Buffer_t {
+    char *Memory = nullptr;
+    uint64_t Offset = 0;
+    uint32_t Size = 0;
+    int32_t Result = 0;
+    bool Done = false;
+    bool Registered = false;
+
+    //
+    // The block is read after the room for a straddling record.
+    //
+
+    char *Data() const { return Memory + BlockSize; }
+  };
+
+  IoRing_t Ring_;
+  int Fd_ = -1;
+  uint64_t Size_ = 0;
+
+  //
+  // The buffers; the ones being read (in the order of the file), the free
+  // ones, and the ones the current batch went through. |Current_| is the one
+  // being walked, and |NextOffset_| the offset of the next block to read.
+  //
+
+  std::vector<Buffer_t> Buffers_;
+  std::deque<size_t> Reading_;
+  std::vector<size_t> Free_;
+  std::vector<size_t> Retired_;
+  size_t Current_ = NoBuffer;
+  uint64_t NextOffset_ = 0;
+
+  static constexpr size_t NoBuffer = ~size_t(0);
+
+public:
+  RingTrace_t() = default;
+  ~RingTrace_t() {
+
+    //
+    // The kernel might still be writing into the buffers.
+    //
+
+    Drain();
+#if defined(__linux__)
+    for (const Buffer_t &Buffer : Buffers_) {
+      munmap(Buffer.Memory, 2 * BlockSize);
+    }
+
+    if (Fd_ != -1) {
+      close(Fd_);
+    }
+#endif
+  }
+
+  //
+  // Rule of three.
+  //
+
+  RingTrace_t(const RingTrace_t &) = delete;
+  RingTrace_t &operator=(RingTrace_t &) = delete;
+
+  //
+  // Open the trace at |Path| and start reading it.
+  //
+
+  bool Open(const fs::path &Path) {
+#if defined(__linux__)
+    Fd_ = open(Path.string().c_str(), O_RDONLY | O_CLOEXEC);
+    if (Fd_ == -1) {
+      fmt::print("Could not open input {}\n", Path.string());
+      return false;
+    }
+
+    struct stat Stat;
+    if (fstat(Fd_, &Stat) != 0) {
+      fmt::print("Could not get the size of {}\n", Path.string());
+      return false;
+    }
+
+    Size_ = Stat.st_size;
+    posix_fadvise(Fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (!Ring_.Init(uint32_t(QueueDepth))) {
+      fmt::print("Could not set up the io_uring\n");
+      return false;
+    }
+
+    std::vector<IoBuffer_t> Registered;
+    for (size_t Idx = 0; Idx < QueueDepth; Idx++) {
+      if (!AddBuffer()) {
+        return false;
+      }
+
+      Registered.push_back(IoBuffer_t{Buffers_[Idx].Data(), BlockSize});
+    }
+
+    //
+    // If the buffers can't be registered (RLIMIT_MEMLOCK), the reads just
+    // won't be registered ones.
+    //
+
+    const bool Registering = Ring_.RegisterBuffers(Registered);
+    for (Buffer_t &Buffer : Buffers_) {
+      Buffer.Registered = Registering;
+    }
+
+    return Rewind();
+#else
+    fmt::print("io_uring is only supported on Linux ({})\n", Path.string());
+    return false;
+#endif
+  }
+
+  uint64_t Size() const { return Size_; }
+
+  //
+  // Start reading the trace from its beginning again.
+  //
+
+  bool Rewind() {
+    Drain();
+    Reading_.clear();
+    Retired_.clear();
+    Free_.clear();
+    for (size_t Idx = Buffers_.size(); Idx > 0; Idx--) {
+      Free_.push_back(Idx - 1);
+    }
+
+    Current_ = NoBuffer;
+    NextOffset_ = 0;
+    return Fill();
+  }
+
+  //
+  // Move on to the next block. |Carry| is the beginning of the record the
+  // current block ends with, which gets copied in front of the next block.
+  // |Begin| and |End| are set to the records of the next block.
+  //
+
+  bool Next(const char *Carry, const size_t CarrySize, const char *&Begin,
+            const char *&End) {
+    if (CarrySize > BlockSize) {
+      fmt::print("A record at {:#x} is larger than the block size\n",
+                 OffsetOf(Carry));
+      return false;
+    }
+
+    //
+    // If the batch went through every buffer, there is nothing being read
+    // anymore; add a buffer to keep going.
+    //
+
+    if (Reading_.empty()) {
+      if (NextOffset_ >= Size_) {
+        return false;
+      }
+
+      if (!AddBuffer() || !Fill()) {
+        return false;
+      }
+    }
+
+    const size_t BufferIdx = Reading_.front();
+    if (!Wait(BufferIdx)) {
+      return false;
+    }
+
+    Reading_.pop_front();
+    Buffer_t &Buffer = Buffers_[BufferIdx];
+    char *Data = Buffer.Data();
+    if (CarrySize > 0) {
+      memcpy(Data - CarrySize, Carry, CarrySize);
+    }
+
+    if (Current_ != NoBuffer) {
+      Retired_.push_back(Current_);
+    }
+
+    Current_ = BufferIdx;
+    Begin = Data - CarrySize;
+    End = Data + Buffer.Size;
+    return true;
+  }
+
+  //
+  // Recycle the buffers walked before the current one; nothing points into
+  // them anymore.
+  //
+
+  bool Release() {
+    Free_.insert(Free_.end(), Retired_.begin(), Retired_.end());
+    Retired_.clear();
+    return Fill();
+  }
+
+  //
+  // Returns the offset in the file of |Position|, which points into the
+  // current block.
+  //
+
+  uint64_t OffsetOf(const char *Position) const {
+    if (Current_ == NoBuffer) {
+      return 0;
+    }
+
+    const Buffer_t &Buffer = Buffers_[Current_];
+    return Buffer.Offset + (Position - Buffer.Data());
+  }
+
+private:
+  bool AddBuffer() {
+#if defined(__linux__)
+    void *Memory = mmap(nullptr, 2 * BlockSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Memory == MAP_FAILED) {
+      fmt::print("Could not allocate a read buffer\n");
+      return false;
+    }
+
+    Buffer_t Buffer;
+    Buffer.Memory = (char *)Memory;
+    Buffers_.push_back(Buffer);
+    Free_.push_back(Buffers_.size() - 1);
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  //
+  // Queue the reads of the next blocks into the free buffers.
+  //
+
+  bool Fill() {
+    while (!Free_.empty() && NextOffset_ < Size_) {
+      const size_t BufferIdx = Free_.back();
+      Free_.pop_back();
+      Buffer_t &Buffer = Buffers_[BufferIdx];
+      Buffer.Offset = NextOffset_;
+      Buffer.Size =
+          uint32_t(std::min<uint64_t>(BlockSize, Size_ - NextOffset_));
+      Buffer.Done = false;
+      const int BufferIndex = Buffer.Registered ? int(BufferIdx) : -1;
+      if (!Ring_.Read(Fd_, Buffer.Data(), Buffer.Size, Buffer.Offset,
+                      BufferIndex, BufferIdx)) {
+        fmt::print("Could not queue the read at {:#x}\n", Buffer.Offset);
+        return false;
+      }
+
+      NextOffset_ += Buffer.Size;
+      Reading_.push_back(BufferIdx);
+    }
+
+    return Ring_.Submit();
+  }
+
+  //
+  // Wait for the read of |BufferIdx| to be done; short reads are completed
+  // synchronously.
+  //
+
+  bool Wait(const size_t BufferIdx) {
+    Buffer_t &Buffer = Buffers_[BufferIdx];
+    while (!Buffer.Done) {
+      uint64_t UserData = 0;
+      int32_t Result = 0;
+      if (!Ring_.Complete(UserData, Result)) {
+        fmt::print("Could not reap a read completion\n");
+        return false;
+      }
+
+      Buffers_[UserData].Result = Result;
+      Buffers_[UserData].Done = true;
+    }
+
+    if (Buffer.Result < 0) {
+      fmt::print("Could not read at {:#x} ({})\n", Buffer.Offset,
+                 strerror(-Buffer.Result));
+      return false;
+    }
+
+#if defined(__linux__)
+    uint32_t Read = uint32_t(Buffer.Result);
+    while (Read < Buffer.Size) {
+      const ssize_t Amount = pread(Fd_, Buffer.Data() + Read,
+                                   Buffer.Size - Read, Buffer.Offset + Read);
+      if (Amount < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (Amount <= 0) {
+        fmt::print("Could not read at {:#x}\n", Buffer.Offset + Read);
+        return false;
+      }
+
+      Read += uint32_t(Amount);
+    }
+#endif
+
+    return true;
+  }
+
+  //
+  // Wait for every read in flight.
+  //
+
+  void Drain() {
+    uint64_t UserData = 0;
+    int32_t Result = 0;
+    while (Ring_.InFlight() > 0 && Ring_.Complete(UserData, Result)) {
+    }
+  }
+};
+
+//
+// This walks the records of a trace read by a |RingTrace_t| with a
+// |Reader_t|. When the reader runs out of complete records, it is rebased on
+// the next block. The records handed out stay valid until |Release| is
+// called.
+//
+
+template <typename Reader_t> class RingReader_t {
+  RingTrace_t &Trace_;
+  Reader_t Reader_;
+  const char *End_;
+
+public:
+  explicit RingReader_t(RingTrace_t &Trace, const char *Begin, const char *End)
+      : Trace_(Trace), Reader_(Begin, End), End_(End) {}
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    while (!Reader_.Next(Address, Line)) {
+      const char *Position = Reader_.Position();
+      const char *Begin = nullptr;
+      const char *End = nullptr;
+      if (!Trace_.Next(Position, End_ - Position, Begin, End)) {
+        return false;
+      }
+
+      Reader_.Rebase(Begin, End);
+      End_ = End;
+    }
+
+    return true;
+  }
+
+  template <typename Spec_t> void Select(const Spec_t &Spec) {
+    Reader_.Select(Spec);
+  }
+
+  uint64_t LineNumber() const
+    requires requires(const Reader_t &Reader) { Reader.LineNumber(); }
+  {
+    return Reader_.LineNumber();
+  }
+
+  void Release() { Trace_.Release(); }
+  const char *Position() const { return Reader_.Position(); }
+  uint64_t Offset() const { return Trace_.OffsetOf(Reader_.Position()); }
+};
@@ -0,0 +1,170 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//
+// The calls made to the symbol backend (dbgeng, the symbol map) and how long
+// they took.
+//
+
+struct BackendStats_t {
+  uint64_t Calls = 0;
+  uint64_t Ns = 0;
+  uint64_t MaxNs = 0;
+
+  void Record(const uint64_t CallNs) {
+    Calls++;
+    Ns += CallNs;
+    MaxNs = std::max(MaxNs, CallNs);
+  }
+
+  void Merge(const BackendStats_t &Other) {
+    Calls += Other.Calls;
+    Ns += Other.Ns;
+    MaxNs = std::max(MaxNs, Other.MaxNs);
+  }
+};
+
+//
+// The stats of a single file.
+//
+
+struct FileStats_t {
+  std::string Name;
+  uint64_t NumberSymbolizedLines = 0;
+  uint64_t NumberFailedSymbolization = 0;
+  uint64_t BytesRead = 0;
+  uint64_t BytesWritten = 0;
+  uint64_t Ns = 0;
+};
+
+//
+// The peak memory usage of the main data structures, in bytes: the address
+// cache, the index of the distinct addresses, the buffers and the entries of
+// the sinks.
+//
+
+struct MemoryStats_t {
+  uint64_t Cache = 0;
+  uint64_t Index = 0;
+  uint64_t Buffers = 0;
+  uint64_t Sinks = 0;
+};
+
+//
+// Various stats we keep track of. The stage timings are accumulated once per
+// batch of lines, which keeps them cheap enough to always be on.
+//
+
+struct Stats_t {
+  uint64_t NumberSymbolizedLines = 0;
+  uint64_t NumberFailedSymbolization = 0;
+  uint64_t NumberFoldedLines = 0;
+  uint64_t NumberScannedLines = 0;
+  uint64_t NumberFiles = 0;
+
+  //
+  // The time spent in every stage, in nanoseconds: reading addresses off the
+  // traces, turning them into symbols, formatting the output lines and
+  // writing them out.
+  //
+
+  uint64_t ParseNs = 0;
+  uint64_t SymbolizeNs = 0;
+  uint64_t FormatNs = 0;
+  uint64_t WriteNs = 0;
+
+  //
+  // The address cache efficiency, the backend calls and the memory usage.
+  //
+
+  uint64_t CacheHits = 0;
+  uint64_t CacheMisses = 0;
+  uint64_t CacheEvictions = 0;
+  BackendStats_t Backend;
+  MemoryStats_t Memory;
+
+  uint64_t BytesRead = 0;
+  uint64_t BytesWritten = 0;
+  std::vector<FileStats_t> Files;
+
+  //
+  // Dump the stats as JSON into |Path|; |WallNs| is how long the whole run
+  // took.
+  //
+
+  bool DumpJson(const fs::path &Path, const uint64_t WallNs) const {
+    FILE *File = fopen(Path.string().c_str(), "wb");
+    if (File == nullptr) {
+      fmt::print("Could not create {}\n", Path.string());
+      return false;
+    }
+
+    const auto &PerSecond = [](const uint64_t Value, const uint64_t Ns) {
+      return Ns > 0 ? (double(Value) * 1'000'000'000) / double(Ns) : 0.;
+    };
+
+    fmt::memory_buffer Json;
+    auto Out = std::back_inserter(Json);
+    fmt::format_to(Out, "{{\n");
+    fmt::format_to(Out, "  \"wall_ns\": {},\n", WallNs);
+    fmt::format_to(Out, "  \"files\": {},\n", NumberFiles);
+    fmt::format_to(Out, "  \"symbolized_lines\": {},\n", NumberSymbolizedLines);
+    fmt::format_to(Out, "  \"failed_lines\": {},\n", NumberFailedSymbolization);
+    fmt::format_to(Out, "  \"folded_lines\": {},\n", NumberFoldedLines);
+    fmt::format_to(Out, "  \"scanned_lines\": {},\n", NumberScannedLines);
+    fmt::format_to(Out, "  \"lines_per_second\": {:.0f},\n",
+                   PerSecond(NumberSymbolizedLines, WallNs));
+    fmt::format_to(Out,
+                   "  \"stages_ns\": {{\"parse\": {}, \"symbolize\": {}, "
+                   "\"format\": {}, \"write\": {}}},\n",
+                   ParseNs, SymbolizeNs, FormatNs, WriteNs);
+    fmt::format_to(Out,
+                   "  \"cache\": {{\"hits\": {}, \"misses\": {}, "
+                   "\"evictions\": {}}},\n",
+                   CacheHits, CacheMisses, CacheEvictions);
+    fmt::format_to(Out,
+                   "  \"backend\": {{\"calls\": {}, \"total_ns\": {}, "
+                   "\"mean_ns\": {}, \"max_ns\": {}}},\n",
+                   Backend.Calls, Backend.Ns,
+                   Backend.Calls > 0 ? Backend.Ns / Backend.Calls : 0,
+                   Backend.MaxNs);
+    fmt::format_to(Out, "  \"bytes_read\": {},\n", BytesRead);
+    fmt::format_to(Out, "  \"bytes_written\": {},\n", BytesWritten);
+    fmt::format_to(Out, "  \"peak_memory\": {},\n", PeakMemoryUsage());
+    fmt::format_to(Out,
+                   "  \"memory\": {{\"cache\": {}, \"index\": {}, "
+                   "\"buffers\": {}, \"sinks\": {}}},\n",
+                   Memory.Cache, Memory.Index, Memory.Buffers, Memory.Sinks);
+    fmt::format_to(Out, "  \"per_file\": [");
+    for (size_t Idx = 0; Idx < Files.size(); Idx++) {
+      const FileStats_t &File = Files[Idx];
+      fmt::format_to(Out, "{}\n    {{\"name\": \"", Idx > 0 ? "," : "");
+      AppendJsonEscaped(Json, File.Name);
+      fmt::format_to(
+          Out,
+          "\", \"symbolized_lines\": {}, "
+          "\"failed_lines\": {}, \"bytes_read\": {}, \"bytes_written\": {}, "
+          "\"ns\": {}, \"lines_per_second\": {:.0f}, "
+          "\"bytes_per_second\": {:.0f}}}",
+          File.NumberSymbolizedLines, File.NumberFailedSymbolization,
+          File.BytesRead, File.BytesWritten, File.Ns,
+          PerSecond(File.NumberSymbolizedLines, File.Ns),
+          PerSecond(File.BytesRead, File.Ns));
+    }
+    fmt::format_to(Out, "{}]\n}}\n", Files.empty() ? "" : "\n  ");
+
+    const size_t Written = fwrite(Json.data(), 1, Json.size(), File);
+    return (fclose(File) == 0) && Written == Json.size();
+  }
+};
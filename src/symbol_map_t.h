@@ -0,0 +1,305 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "symbolize.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/format.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//
+// This is a symbol source that doesn't need dbgeng nor a crash-dump: it is a
+// table of modules and of the symbols they contain. It exposes the same
+// interface as DbgEng_t which allows to run the symbolization code on any
+// platform (think benchmarks, or synthetic traces).
+//
+// A symbol map can be stored in a text file that looks like the below; the
+// numbers are in hexadecimal and the lines starting with '#' are ignored:
+//
+//   module <base> <size> <name>
+//   symbol <address> <name>
+//
+
+class SymbolMap_t {
+  struct Module_t {
+    uint64_t Base = 0;
+    uint64_t Size = 0;
+    std::string Name;
+  };
+
+  struct Symbol_t {
+    uint64_t Address = 0;
+    std::string Name;
+  };
+
+  //
+  // The modules sorted by base address, and the symbols sorted by address.
+  //
+
+  std::vector<Module_t> Modules_;
+  std::vector<Symbol_t> Symbols_;
+
+  //
+  // This is the internal cache.
+  //
+
+  SymbolCache_t Cache_;
+
+public:
+  //
+  // Add a module named |Name| spanning [|Base|, |Base| + |Size|).
+  //
+
+  void AddModule(const std::string &Name, const uint64_t Base,
+                 const uint64_t Size) {
+    InsertSorted(Modules_, Module_t{Base, Size, Name},
+                 [](const Module_t &M) { return M.Base; });
+  }
+
+  //
+  // Add a symbol named |Name| starting at |Address|.
+  //
+
+  void AddSymbol(const std::string &Name, const uint64_t Address) {
+    InsertSorted(Symbols_, Symbol_t{Address, Name},
+                 [](const Symbol_t &S) { return S.Address; });
+  }
+
+  //
+  // Load the symbol map stored in |SymbolMapPath|.
+  //
+
+  bool Init(const fs::path &SymbolMapPath) {
+    FILE *File = fopen(SymbolMapPath.string().c_str(), "rb");
+    if (File == nullptr) {
+      fmt::print("Could not open the symbol map {}\n", SymbolMapPath.string());
+      return false;
+    }
+
+    std::string Content;
+    char Buffer[0x10'000];
+    size_t Read = 0;
+    while ((Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0) {
+      Content.append(Buffer, Read);
+    }
+
+    fclose(File);
+
+    size_t LineNumber = 0;
+    std::string_view Remaining(Content);
+    while (!Remaining.empty()) {
+      LineNumber++;
+      const size_t LineFeed = Remaining.find('\n');
+      std::string_view Line = Remaining.substr(0, LineFeed);
+      Remaining.remove_prefix(LineFeed == Remaining.npos ? Remaining.size()
+                                                         : LineFeed + 1);
+      while (!Line.empty() && (Line.back() == '\r' || Line.back() == ' ')) {
+        Line.remove_suffix(1);
+      }
+
+      if (Line.empty() || Line.front() == '#') {
+        continue;
+      }
+
+      if (!ParseLine(Line)) {
+        fmt::print("{}:{}: Could not parse '{}'\n", SymbolMapPath.string(),
+                   LineNumber, Line);
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  //
+  // Store the symbol map into |SymbolMapPath|.
+  //
+
+  bool Save(const fs::path &SymbolMapPath) const {
+    FILE *File = fopen(SymbolMapPath.string().c_str(), "wb");
+    if (File == nullptr) {
+      fmt::print("Could not create the symbol map {}\n",
+                 SymbolMapPath.string());
+      return false;
+    }
+
+    for (const auto &Module : Modules_) {
+      fmt::print(File, "module {:#x} {:#x} {}\n", Module.Base, Module.Size,
+                 Module.Name);
+    }
+
+    for (const auto &Symbol : Symbols_) {
+      fmt::print(File, "symbol {:#x} {}\n", Symbol.Address, Symbol.Name);
+    }
+
+    return fclose(File) == 0;
+  }
+
+  size_t NumberModules() const { return Modules_.size(); }
+  size_t NumberSymbols() const { return Symbols_.size(); }
+
+  //
+  // This returns the symbolized version of |SymbolAddress| according to a
+  // |Style|.
+  //
+
+  std::optional<std::reference_wrapper<std::string>>
+  Symbolize(const uint64_t SymbolAddress, const TraceStyle_t Style) {
+    return Cache_.Symbolize(SymbolAddress, [&](const uint64_t Address) {
+      return Resolve(Address, Style);
+    });
+  }
+
+  //
+  // This returns the symbolized version of |SymbolAddress| according to a
+  // |Style| without going through the cache.
+  //
+
+  std::optional<std::string> Resolve(const uint64_t SymbolAddress,
+                                     const TraceStyle_t Style) const {
+    const auto &Info = ResolveInfo(SymbolAddress);
+    if (!Info.has_value()) {
+      return {};
+    }
+
+    return FormatSymbol(SymbolAddress, *Info, Style);
+  }
+
+  //
+  // This returns the module and the symbol |SymbolAddress| belongs to,
+  // without going through the cache.
+  //
+
+  std::optional<SymbolInfo_t> ResolveInfo(const uint64_t SymbolAddress) const {
+    //
+    // Find the module the address belongs to.
+    //
+
+    auto ModuleIt = std::upper_bound(
+        Modules_.begin(), Modules_.end(), SymbolAddress,
+        [](const uint64_t Address, const Module_t &M) {
+          return Address < M.Base;
+        });
+
+    if (ModuleIt == Modules_.begin()) {
+      return {};
+    }
+
+    const Module_t &Module = *std::prev(ModuleIt);
+    const uint64_t Offset = SymbolAddress - Module.Base;
+    if (Offset >= Module.Size) {
+      return {};
+    }
+
+    SymbolInfo_t Info;
+    Info.Module = Module.Name;
+    Info.ModuleBase = Module.Base;
+    Info.Displacement = Offset;
+
+    //
+    // Find the closest symbol before the address, as long as it belongs to
+    // the module.
+    //
+
+    auto SymbolIt = std::upper_bound(
+        Symbols_.begin(), Symbols_.end(), SymbolAddress,
+        [](const uint64_t Address, const Symbol_t &S) {
+          return Address < S.Address;
+        });
+
+    if (SymbolIt != Symbols_.begin() &&
+        std::prev(SymbolIt)->Address >= Module.Base) {
+      const Symbol_t &Symbol = *std::prev(SymbolIt);
+      Info.Symbol = Symbol.Name;
+      Info.Displacement = SymbolAddress - Symbol.Address;
+    }
+
+    return Info;
+  }
+
+  //
+  // Empty the cache.
+  //
+
+  void ClearCache() { Cache_.Clear(); }
+
+  //
+  // The address cache.
+  //
+
+  SymbolCache_t &Cache() { return Cache_; }
+
+private:
+  //
+  // Parse a line of a symbol map file.
+  //
+
+  bool ParseLine(std::string_view Line) {
+    //
+    // Pop the next space separated field off the line.
+    //
+
+    const auto &NextField = [&]() {
+      const size_t Space = Line.find(' ');
+      const std::string_view Field = Line.substr(0, Space);
+      Line.remove_prefix(Space == Line.npos ? Line.size() : Space + 1);
+      return Field;
+    };
+
+    const auto &NextNumber = [&](uint64_t &Number) {
+      const std::string Field(NextField());
+      char *FieldEnd = nullptr;
+      Number = std::strtoull(Field.c_str(), &FieldEnd, 16);
+      return !Field.empty() && *FieldEnd == '\0';
+    };
+
+    const std::string_view Kind = NextField();
+    if (Kind == "module") {
+      uint64_t Base = 0, Size = 0;
+      if (!NextNumber(Base) || !NextNumber(Size) || Line.empty()) {
+        return false;
+      }
+
+      AddModule(std::string(Line), Base, Size);
+      return true;
+    }
+
+    if (Kind == "symbol") {
+      uint64_t Address = 0;
+      if (!NextNumber(Address) || Line.empty()) {
+        return false;
+      }
+
+      AddSymbol(std::string(Line), Address);
+      return true;
+    }
+
+    return false;
+  }
+
+  //
+  // Insert |Value| into the sorted |Values|. Tables are usually built in
+  // order, so appending is the fast path.
+  //
+
+  template <typename T_t, typename F_t>
+  static void InsertSorted(std::vector<T_t> &Values, T_t &&Value,
+                           const F_t &Key) {
+    if (Values.empty() || Key(Values.back()) <= Key(Value)) {
+      Values.emplace_back(std::move(Value));
+      return;
+    }
+
+    const auto &It = std::upper_bound(
+        Values.begin(), Values.end(), Key(Value),
+        [&](const uint64_t K, const T_t &V) { return K < Key(V); });
+    Values.insert(It, std::move(Value));
+  }
+};
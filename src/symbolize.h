@@ -0,0 +1,2304 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "distinct_t.h"
+#include "hex_scanner_t.h"
+#include "io_ring_t.h"
+#include "loop_folder_t.h"
+#include "output_format_t.h"
+#include "pack_t.h"
+#include "perf_counters_t.h"
+#include "pipe_writer_t.h"
+#include "preallocated_file_t.h"
+#include "progress_t.h"
+#include "ring_trace_t.h"
+#include "stats_t.h"
+#include "trace_readers.h"
+#include "trace_windows_t.h"
+#include "utils.h"
+#ifdef SYMBOLIZER_INSTRUMENTATION
+#include "instrumentation_t.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fmt/os.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//
+// The trace style supported; |Custom| is the output format given with
+// --format, and |Jsonl| is turned into the JSON Lines output format.
+//
+
+enum class TraceStyle_t { Modoff, FullSymbol, Custom, Jsonl };
+
+//
+// What --scan does with the addresses it finds in text: |Replace| them with
+// their symbols, or |Annotate| them with their symbols.
+//
+
+enum class ScanMode_t { Off, Replace, Annotate };
+
+//
+// Format the symbol of |Address| described by |Info| in one of the built-in
+// styles. If the address isn't in a symbol, we fall back to module+offset like
+// dbgeng does.
+//
+
+inline std::string FormatSymbol(const uint64_t Address,
+                                const SymbolInfo_t &Info,
+                                const TraceStyle_t Style) {
+  if (Style == TraceStyle_t::Modoff || Info.Symbol.empty()) {
+    return fmt::format("{}+0x{:x}", Info.Module, Address - Info.ModuleBase);
+  }
+
+  return fmt::format("{}!{}+0x{:x}", Info.Module, Info.Symbol,
+                     Info.Displacement);
+}
+
+//
+// The various commad line options that Symbolizer supports.
+//
+
+struct Opts_t {
+
+  //
+  // The input path can be:
+  //   - A path to a directory full of traces to symbolize,
+  //   - A path to an input trace to symbolize.
+  //
+
+  fs::path Input;
+
+  //
+  // The output path can be:
+  //   - A path to a directory where the output trace(s) are going to be written
+  //   into,
+  //   - A path to an output file where the output trace is going to be written
+  //   into,
+  //   - Empty if the output is to be dumped on stdout.
+  //
+
+  fs::path Output;
+
+  //
+  // This is the path to the crash-dump to load.
+  //
+
+  fs::path CrashdumpPath;
+
+  //
+  // This is the path to the symbol map to load instead of a crash-dump.
+  //
+
+  fs::path SymbolMapPath;
+
+  //
+  // This is the format of the input traces.
+  //
+
+  TraceFormat_t Format = TraceFormat_t::Hex;
+
+  //
+  // Skip a number of lines.
+  //
+
+  uint64_t Skip = 0;
+
+  //
+  // The maximum amount of lines to process per file.
+  //
+
+  uint64_t Max = 0;
+
+  //
+  // This is the style used to output traces.
+  //
+
+  TraceStyle_t Style = TraceStyle_t::FullSymbol;
+
+  //
+  // The output format when the style is |Custom|.
+  //
+
+  OutputFormat_t OutputFormat;
+
+  //
+  // Allow symbolizer to overwrite output traces.
+  //
+
+  bool Overwrite = false;
+
+  //
+  // Include line numbers in the output traces.
+  //
+
+  bool LineNumbers = false;
+
+  //
+  // Extract the distinct addresses of a trace first, resolve them in one go and
+  // only then write the output trace. On huge traces, this is faster and
+  // lighter than going through the address cache.
+  //
+
+  bool Distinct = false;
+
+  //
+  // The memory budget (in MB) of the distinct address extraction.
+  //
+
+  uint64_t DistinctBudget = 1'024;
+
+  //
+  // The directory where the distinct address extraction spills sorted runs
+  // when it runs out of memory budget.
+  //
+
+  fs::path SpillDir;
+
+  //
+  // Where the run statistics are dumped as JSON; nowhere if empty.
+  //
+
+  fs::path StatsJsonPath;
+
+  //
+  // Report the progress of the run on stderr.
+  //
+
+  bool Progress = false;
+
+  //
+  // Sample the hardware performance counters around every stage.
+  //
+
+  bool PerfCounters = false;
+
+  //
+  // The memory budget (in MB) of the address cache; zero for unlimited.
+  //
+
+  uint64_t CacheBudget = 0;
+
+  //
+  // The size (in MB) of the windows the traces are mapped with; zero for the
+  // default.
+  //
+
+  uint64_t WindowSize = 0;
+
+  //
+  // Fault the windows in when they get mapped, and back them with huge pages.
+  //
+
+  bool Populate = true;
+  bool HugePages = false;
+
+  //
+  // The I/O engine the traces are read and the outputs written with.
+  //
+
+  IoEngine_t IoEngine = IoEngine_t::Blocking;
+
+  //
+  // The number of threads symbolizing chunks of a trace and writing them into
+  // the output file in parallel; zero to symbolize on a single thread.
+  //
+
+  uint32_t Jobs = 0;
+
+  //
+  // The largest loop body folded into its first iteration and a repeat count;
+  // zero to not fold loops.
+  //
+
+  uint64_t FoldLoops = 0;
+
+  //
+  // Append the outputs to a single pack file at |Output| rather than writing
+  // a file per output.
+  //
+
+  bool Pack = false;
+
+  //
+  // Look for the addresses anywhere in the lines of the inputs (logs, stack
+  // dumps, etc.) instead of reading one address per line.
+  //
+
+  ScanMode_t Scan = ScanMode_t::Off;
+
+  //
+  // Read the addresses from a column of the lines of hex traces rather than
+  // from their start; off if the column is zero.
+  //
+
+  ColumnSpec_t Columns;
+
+  //
+  // Keep the rest of the lines around the symbols in the output traces.
+  //
+
+  bool Passthrough = false;
+};
+
+//
+// This is the address cache. Granted that resolving symbols is a pretty slow
+// process and the fact that traces usually contain a smaller number of
+// *unique* addresses executed, this gets us a really nice boost.
+//
+// On traces with a very wide coverage it can grow very large though, so it
+// can be given a memory budget. Once it is over budget, |Trim| evicts entries
+// with the CLOCK policy: a hand sweeps over the entries in the order they were
+// inserted, gives a second chance to the ones that have been used since its
+// last visit and evicts the others. Eviction only happens in |Trim| so that
+// the symbols handed out stay valid until the caller is done with them (the
+// end of a batch of lines).
+//
+
+class SymbolCache_t {
+  struct Entry_t {
+    std::string Symbol;
+    bool Referenced = true;
+  };
+
+  //
+  // A slot of the clock; free slots get reused by new entries.
+  //
+
+  struct Slot_t {
+    uint64_t Address = 0;
+    bool Used = false;
+  };
+
+  std::unordered_map<uint64_t, Entry_t> Cache_;
+  std::vector<Slot_t> Clock_;
+  std::vector<size_t> Free_;
+
+  //
+  // The CLOCK hand, the memory budget in bytes (zero for unlimited) and the
+  // estimated memory usage.
+  //
+
+  size_t Hand_ = 0;
+  uint64_t Budget_ = 0;
+  uint64_t Bytes_ = 0;
+  uint64_t PeakBytes_ = 0;
+  uint64_t Evictions_ = 0;
+
+  //
+  // How efficient the cache is, and the backend calls made on misses.
+  //
+
+  uint64_t Hits_ = 0;
+  uint64_t Misses_ = 0;
+  BackendStats_t Backend_;
+
+  //
+  // Estimate the memory an entry uses: its node in the cache, its clock slot
+  // and the heap allocation of the symbol if it doesn't fit inline.
+  //
+
+  static uint64_t EntryBytes(const Entry_t &Entry) {
+    constexpr uint64_t NodeBytes =
+        sizeof(std::pair<const uint64_t, Entry_t>) + (2 * sizeof(void *));
+    static const size_t InlineCapacity = std::string().capacity();
+    const size_t Capacity = Entry.Symbol.capacity();
+    return NodeBytes + sizeof(Slot_t) +
+           (Capacity > InlineCapacity ? Capacity + 1 : 0);
+  }
+
+public:
+  //
+  // Returns the cached symbol of |Address| if there is one.
+  //
+
+  std::optional<std::reference_wrapper<std::string>>
+  Find(const uint64_t Address) {
+    const auto &It = Cache_.find(Address);
+    if (It == Cache_.end()) {
+      return {};
+    }
+
+    //
+    // Only write the reference bit if needed, to not dirty the cache line of
+    // hot entries over and over.
+    //
+
+    Entry_t &Entry = It->second;
+    if (!Entry.Referenced) {
+      Entry.Referenced = true;
+    }
+
+    return Entry.Symbol;
+  }
+
+  //
+  // Returns the symbol of |Address|; if it is not in the cache yet, |Resolve|
+  // is invoked and its result is fed into the cache.
+  //
+
+  template <typename F_t>
+  std::optional<std::reference_wrapper<std::string>>
+  Symbolize(const uint64_t Address, F_t &&Resolve) {
+    //
+    // Fast path for the addresses we have symbolized already.
+    //
+
+#ifdef SYMBOLIZER_INSTRUMENTATION
+    const auto &Probe = chrono::steady_clock::now();
+#endif
+
+    const auto &Cached = Find(Address);
+
+#ifdef SYMBOLIZER_INSTRUMENTATION
+    Instrumentation().Record(Latency_t::CacheProbe, NanosecondsSince(Probe));
+#endif
+
+    if (Cached) {
+#ifdef SYMBOLIZER_INSTRUMENTATION
+      Instrumentation().Hit(Address);
+#endif
+
+      Hits_++;
+      return Cached;
+    }
+
+    //
+    // Slow path, we need to ask the backend..
+    //
+
+    Misses_++;
+    const auto &Before = chrono::steady_clock::now();
+    auto Res = Resolve(Address);
+    Backend_.Record(NanosecondsSince(Before));
+
+#ifdef SYMBOLIZER_INSTRUMENTATION
+    Instrumentation().Record(Latency_t::BackendResolve,
+                             NanosecondsSince(Before));
+    Instrumentation().Resolved(Address, Res);
+#endif
+
+    //
+    // If there has been an issue during symbolization, bail as it is not
+    // expected.
+    //
+
+    if (!Res) {
+      return {};
+    }
+
+    //
+    // Feed the result into the cache and the clock (in a free slot if there
+    // is one), and return the entry directly from it.
+    //
+
+    if (Free_.empty()) {
+      Clock_.emplace_back(Slot_t{Address, true});
+    } else {
+      Clock_[Free_.back()] = Slot_t{Address, true};
+      Free_.pop_back();
+    }
+
+    Entry_t &Entry =
+        Cache_.emplace(Address, Entry_t{std::move(*Res)}).first->second;
+    Bytes_ += EntryBytes(Entry);
+    PeakBytes_ = std::max(PeakBytes_, Bytes_);
+    return Entry.Symbol;
+  }
+
+  //
+  // Set the memory budget of the cache in bytes; zero means unlimited.
+  //
+
+  void SetBudget(const uint64_t Budget) { Budget_ = Budget; }
+
+  //
+  // Evict entries until the cache is within its budget. This invalidates the
+  // symbols handed out before.
+  //
+
+  void Trim() {
+    if (Budget_ == 0) {
+      return;
+    }
+
+    while (Bytes_ > Budget_ && !Cache_.empty()) {
+      const size_t Slot = Hand_;
+      Hand_ = (Hand_ + 1) % Clock_.size();
+      if (!Clock_[Slot].Used) {
+        continue;
+      }
+
+      //
+      // Second chance for the entries used since our last visit.
+      //
+
+      const auto &It = Cache_.find(Clock_[Slot].Address);
+      if (It->second.Referenced) {
+        It->second.Referenced = false;
+        continue;
+      }
+
+      Bytes_ -= EntryBytes(It->second);
+      Cache_.erase(It);
+      Clock_[Slot].Used = false;
+      Free_.emplace_back(Slot);
+      Evictions_++;
+    }
+  }
+
+  size_t Size() const { return Cache_.size(); }
+  uint64_t Hits() const { return Hits_; }
+  uint64_t Misses() const { return Misses_; }
+  uint64_t Evictions() const { return Evictions_; }
+  uint64_t MemoryUsage() const { return Bytes_; }
+  uint64_t PeakMemoryUsage() const { return PeakBytes_; }
+  const BackendStats_t &Backend() const { return Backend_; }
+
+  void Clear() {
+    Cache_.clear();
+    Clock_.clear();
+    Free_.clear();
+    Hand_ = 0;
+    Bytes_ = 0;
+  }
+};
+
+//
+// The output trace; it is either a file or stdout. The lines are formatted
+// into a buffer that gets written out once it is large enough; |Print| does
+// both while |Append| leaves the flushing to the caller.
+//
+
+class OutputSink_t {
+  std::optional<fmt::file> File_;
+  OutputBuffer_t Buffer_;
+  uint64_t BytesWritten_ = 0;
+  uint64_t WriteNs_ = 0;
+
+  //
+  // Set once a write failed; the lines that follow are dropped and |Close|
+  // reports it.
+  //
+
+  bool Failed_ = false;
+
+  //
+  // The writes go through io_uring when asked to; it is declared last so that
+  // the writes in flight are done before the file gets closed.
+  //
+
+  std::unique_ptr<RingWriter_t> Ring_;
+
+  //
+  // When stdout is a pipe, the buffers are handed over to it with vmsplice.
+  //
+
+  std::unique_ptr<PipeWriter_t> Pipe_;
+
+  //
+  // The buffers are appended to this pack if there is one, as |PackEntry_|.
+  //
+
+  PackWriter_t *Pack_ = nullptr;
+  PackEntry_t PackEntry_;
+
+public:
+  static constexpr size_t FlushThreshold = 1'024 * 1'024;
+
+  OutputSink_t() = default;
+  explicit OutputSink_t(const fs::path &Output,
+                        const IoEngine_t Engine = IoEngine_t::Blocking,
+                        PackWriter_t *Pack = nullptr) {
+    Open(Output, Engine, Pack);
+  }
+
+  ~OutputSink_t() { Close(); }
+
+  //
+  // Rule of three.
+  //
+
+  OutputSink_t(const OutputSink_t &) = delete;
+  OutputSink_t &operator=(OutputSink_t &) = delete;
+
+  //
+  // Open the output |Output|; with a |Pack|, it is the name of the output in
+  // the pack. A sink can be opened again once closed, which keeps its buffer
+  // around: a batch of tiny traces doesn't allocate one for every output.
+  //
+
+  void Open(const fs::path &Output,
+            const IoEngine_t Engine = IoEngine_t::Blocking,
+            PackWriter_t *Pack = nullptr) {
+    if (Pack != nullptr) {
+      Pack_ = Pack;
+      PackEntry_.Name = Output.string();
+      return;
+    }
+
+    if (Output.empty()) {
+      const int Fd = fileno(stdout);
+      if (PipeWriter_t::IsPipe(Fd)) {
+        Pipe_ = std::make_unique<PipeWriter_t>();
+        if (!Pipe_->Init(Fd, Buffer_, FlushThreshold)) {
+          Pipe_.reset();
+        }
+      }
+
+      return;
+    }
+
+    File_.emplace(Output.string(),
+                  fmt::file::WRONLY | fmt::file::CREATE | fmt::file::TRUNC);
+    if (Engine == IoEngine_t::IoUring) {
+      Ring_ = std::make_unique<RingWriter_t>();
+      if (!Ring_->Init(File_->descriptor(), Buffer_, 2 * FlushThreshold)) {
+        Ring_.reset();
+      }
+    }
+  }
+
+  //
+  // Write the buffered lines out and close the output. Returns false if any
+  // of the writes failed.
+  //
+
+  bool Close() {
+    Flush();
+    if (Pack_ != nullptr) {
+      Pack_->Commit(std::move(PackEntry_));
+      PackEntry_ = {};
+      Pack_ = nullptr;
+    }
+
+    if (Ring_ && !Ring_->Drain()) {
+      Failed_ = true;
+    }
+
+    Ring_.reset();
+    Pipe_.reset();
+    File_.reset();
+    const bool Written = !Failed_;
+    Failed_ = false;
+    return Written;
+  }
+
+  template <typename... Args_t>
+  void Print(fmt::format_string<Args_t...> Format, Args_t &&...Args) {
+    Append(Format, std::forward<Args_t>(Args)...);
+    FlushIfFull();
+  }
+
+  template <typename... Args_t>
+  void Append(fmt::format_string<Args_t...> Format, Args_t &&...Args) {
+    fmt::format_to(std::back_inserter(Buffer_), Format,
+                   std::forward<Args_t>(Args)...);
+  }
+
+  void FlushIfFull() {
+    if (Buffer_.size() >= FlushThreshold) {
+      Flush();
+    }
+  }
+
+  //
+  // Write the buffered lines out.
+  //
+
+  void Flush() {
+    if (Buffer_.size() == 0) {
+      return;
+    }
+
+    if (Failed_) {
+      Buffer_.clear();
+      return;
+    }
+
+#ifdef SYMBOLIZER_INSTRUMENTATION
+    ScopedLatency_t Latency(Latency_t::OutputFlush);
+#endif
+
+    const auto &Before = chrono::steady_clock::now();
+    const size_t Size = Buffer_.size();
+    if (Pack_ != nullptr) {
+      if (!Pack_->Append(PackEntry_, Buffer_.data(), Buffer_.size())) {
+        fmt::print("Could not append {} to the pack\n", PackEntry_.Name);
+        Failed_ = true;
+      }
+    } else if (Ring_) {
+      if (!Ring_->Write(Buffer_)) {
+        Failed_ = true;
+      }
+    } else if (Pipe_) {
+
+      //
+      // What has been printed on stdout goes first.
+      //
+
+      fflush(stdout);
+      if (!Pipe_->Write(Buffer_)) {
+        Pipe_.reset();
+      }
+    } else if (File_) {
+      size_t Written = 0;
+      while (Written < Buffer_.size()) {
+        Written += File_->write(Buffer_.data() + Written,
+                                Buffer_.size() - Written);
+      }
+    } else {
+      fwrite(Buffer_.data(), 1, Buffer_.size(), stdout);
+      fflush(stdout);
+    }
+
+    WriteNs_ += NanosecondsSince(Before);
+    BytesWritten_ += Size;
+    Buffer_.clear();
+  }
+
+  //
+  // The buffer the lines get formatted into, for the callers that format
+  // them themselves.
+  //
+
+  OutputBuffer_t &Buffer() { return Buffer_; }
+
+  uint64_t BytesWritten() const { return BytesWritten_ + Buffer_.size(); }
+  uint64_t WriteNs() const { return WriteNs_; }
+
+  //
+  // Is the output stdout (be it through the pipe or not)?
+  //
+
+  bool IsStdout() const { return Pack_ == nullptr && !File_; }
+  uint64_t MemoryUsage() const { return Buffer_.capacity(); }
+};
+
+//
+// The kinds of sinks the lines of a run can be fanned out to on top of the
+// output trace: the trace in the fullsym or modoff style, the coverage (every
+// address once in the modoff style, which Lighthouse loads) and the profile
+// (the number of lines in every function, the hottest first).
+//
+
+enum class SinkKind_t { FullSymbol, Modoff, Coverage, Profile };
+
+//
+// The sinks attached to a run. Every address gets resolved once into what the
+// sinks need, and the lines are then fanned out to all of them from there.
+// The sinks span the whole run: with several traces, the text sinks get their
+// lines one trace after the other, and the coverage and the profile are the
+// ones of all of them.
+//
+
+class Sinks_t {
+  struct Entry_t {
+    std::string FullSymbol;
+    std::string Modoff;
+    uint32_t Function = 0;
+    bool Covered = false;
+  };
+
+  struct Sink_t {
+    SinkKind_t Kind;
+    std::unique_ptr<OutputSink_t> Out;
+  };
+
+  //
+  // The entries of the addresses seen so far. They are kept for the whole
+  // run (the coverage needs to know every address it has written), so unlike
+  // the address cache they aren't bounded by --cache-budget; |MemoryUsage_|
+  // is how much memory they (and the functions below) use.
+  //
+
+  std::vector<Sink_t> Sinks_;
+  std::unordered_map<uint64_t, Entry_t> Entries_;
+  uint64_t MemoryUsage_ = 0;
+
+  //
+  // The kinds of the sinks, as a bitmap.
+  //
+
+  uint32_t Kinds_ = 0;
+
+  //
+  // The functions of the profile and the number of lines in every one of
+  // them.
+  //
+
+  std::unordered_map<std::string, uint32_t> Functions_;
+  std::vector<uint64_t> FunctionHits_;
+
+  bool Has(const SinkKind_t Kind) const {
+    return (Kinds_ & (1U << uint32_t(Kind))) != 0;
+  }
+
+public:
+  bool Empty() const { return Sinks_.empty(); }
+
+  //
+  // Attach a sink of kind |Kind| writing into |Path|.
+  //
+
+  void Open(const SinkKind_t Kind, const fs::path &Path) {
+    Sinks_.emplace_back(Sink_t{Kind, std::make_unique<OutputSink_t>(Path)});
+    Kinds_ |= 1U << uint32_t(Kind);
+  }
+
+  //
+  // Prepare what the sinks need for |Address|, which resolved into |Info|.
+  //
+
+  void Add(const uint64_t Address, const SymbolInfo_t &Info) {
+    const auto &[It, Inserted] = Entries_.try_emplace(Address);
+    if (!Inserted) {
+      return;
+    }
+
+    Entry_t &Entry = It->second;
+    if (Has(SinkKind_t::FullSymbol)) {
+      Entry.FullSymbol = FormatSymbol(Address, Info, TraceStyle_t::FullSymbol);
+    }
+
+    if (Has(SinkKind_t::Modoff) || Has(SinkKind_t::Coverage)) {
+      Entry.Modoff = FormatSymbol(Address, Info, TraceStyle_t::Modoff);
+    }
+
+    if (Has(SinkKind_t::Profile)) {
+      std::string Function = Info.Module;
+      if (!Info.Symbol.empty()) {
+        Function += '!';
+        Function += Info.Symbol;
+      }
+
+      const auto &[FunctionIt, New] = Functions_.try_emplace(
+          std::move(Function), uint32_t(FunctionHits_.size()));
+      if (New) {
+        FunctionHits_.emplace_back(0);
+        MemoryUsage_ += sizeof(*FunctionIt) + FunctionIt->first.capacity() +
+                        sizeof(uint64_t);
+      }
+
+      Entry.Function = FunctionIt->second;
+    }
+
+    MemoryUsage_ += sizeof(*It) + Entry.FullSymbol.capacity() +
+                    Entry.Modoff.capacity();
+  }
+
+  uint64_t MemoryUsage() const { return MemoryUsage_; }
+
+  //
+  // Fan the line of |Address| out to the sinks; the address must have been
+  // added before.
+  //
+
+  void Hit(const uint64_t Address) {
+    const auto &It = Entries_.find(Address);
+    if (It == Entries_.end()) {
+      return;
+    }
+
+    Entry_t &Entry = It->second;
+    for (Sink_t &Sink : Sinks_) {
+      switch (Sink.Kind) {
+      case SinkKind_t::FullSymbol: {
+        Sink.Out->Print("{}\n", Entry.FullSymbol);
+        break;
+      }
+
+      case SinkKind_t::Modoff: {
+        Sink.Out->Print("{}\n", Entry.Modoff);
+        break;
+      }
+
+      case SinkKind_t::Coverage: {
+        if (!Entry.Covered) {
+          Sink.Out->Print("{}\n", Entry.Modoff);
+        }
+        break;
+      }
+
+      case SinkKind_t::Profile: {
+        FunctionHits_[Entry.Function]++;
+        break;
+      }
+      }
+    }
+
+    Entry.Covered = true;
+  }
+
+  //
+  // Write the profiles out, and flush the sinks.
+  //
+
+  void Close() {
+    std::vector<std::pair<uint64_t, const std::string *>> Profile;
+    if (Has(SinkKind_t::Profile)) {
+      Profile.reserve(Functions_.size());
+      for (const auto &[Function, Id] : Functions_) {
+        Profile.emplace_back(FunctionHits_[Id], &Function);
+      }
+
+      std::sort(Profile.begin(), Profile.end(),
+                [](const auto &A, const auto &B) {
+                  return A.first != B.first ? A.first > B.first
+                                            : *A.second < *B.second;
+                });
+    }
+
+    for (Sink_t &Sink : Sinks_) {
+      if (Sink.Kind == SinkKind_t::Profile) {
+        for (const auto &[Hits, Function] : Profile) {
+          Sink.Out->Print("{}\t{}\n", Hits, *Function);
+        }
+      }
+
+      Sink.Out->Flush();
+    }
+  }
+};
+
+//
+// A record of a trace: its line number, the address it holds and its text.
+//
+
+struct TraceRecord_t {
+  uint64_t LineNumber = 0;
+  uint64_t Address = 0;
+  std::string_view Line;
+};
+
+//
+// The maximum number of records handed over at once by ForEachTraceBatch.
+//
+
+constexpr size_t TraceBatchSize = 4'096;
+
+//
+// Walk the records of a trace with |Reader| and invoke |Callback| with batches
+// of records as well as the offset the reader reached, honoring the --skip
+// and --max options. The callback returns the number of lines it symbolized as
+// this is what --max counts; a batch never holds more lines than what is left
+// before hitting --max. This returns true if we stopped because we hit --max.
+//
+
+template <typename Reader_t, typename F_t>
+bool ForEachRecordBatch(const Opts_t &Opts, Reader_t &&Reader, F_t &&Callback) {
+  std::vector<TraceRecord_t> Batch(TraceBatchSize);
+  uint64_t NumberSymbolizedLines = 0;
+  uint64_t LineNumber = 0;
+  TraceRecord_t Record;
+
+  //
+  // Skip the lines up front so that the loop below doesn't check for it on
+  // every line. What they pointed into gets released as we go.
+  //
+
+  for (; LineNumber < Opts.Skip; LineNumber++) {
+    if (!Reader.Next(Record.Address, Record.Line)) {
+      return false;
+    }
+
+    if constexpr (requires { Reader.Release(); }) {
+      if ((LineNumber % TraceBatchSize) == 0) {
+        Reader.Release();
+      }
+    }
+  }
+
+  for (bool Exhausted = false; !Exhausted;) {
+
+    //
+    // Do we have a max value, and if so have we hit it yet? We only did if
+    // there is a line left.
+    //
+
+    size_t Capacity = TraceBatchSize;
+    if (Opts.Max > 0) {
+      const uint64_t Left = Opts.Max - NumberSymbolizedLines;
+      if (Left == 0) {
+        return Reader.Next(Record.Address, Record.Line);
+      }
+
+      Capacity = size_t(std::min<uint64_t>(Capacity, Left));
+    }
+
+    size_t Size = 0;
+    while (Size < Capacity) {
+      TraceRecord_t &Next = Batch[Size];
+      if (!Reader.Next(Next.Address, Next.Line)) {
+        Exhausted = true;
+        break;
+      }
+
+      //
+      // The readers whose records aren't lines know which line a record
+      // comes from.
+      //
+
+      if constexpr (requires { Reader.LineNumber(); }) {
+        Next.LineNumber = Reader.LineNumber();
+      } else {
+        Next.LineNumber = LineNumber;
+      }
+
+      LineNumber++;
+      Size++;
+    }
+
+    if (Size > 0) {
+      const std::span<const TraceRecord_t> Records(Batch.data(), Size);
+      NumberSymbolizedLines += Callback(Records, Reader.Offset());
+    }
+
+    //
+    // The records of the batch aren't used anymore, let the reader release
+    // what they pointed into if it needs to.
+    //
+
+    if constexpr (requires { Reader.Release(); }) {
+      Reader.Release();
+    }
+  }
+
+  return false;
+}
+
+//
+// The inputs a trace can be read from: a buffer in memory, or a trace file
+// mapped one window at a time. |Reader| returns a reader of the given type
+// that walks the input from its beginning.
+//
+
+struct BufferInput_t {
+  const char *Begin = nullptr;
+  const char *End = nullptr;
+
+  template <typename Reader_t> Reader_t Reader() const {
+    return Reader_t(Begin, End);
+  }
+
+  uint64_t Size() const { return End - Begin; }
+};
+
+struct WindowedInput_t {
+  TraceWindows_t &Windows;
+
+  template <typename Reader_t> WindowedReader_t<Reader_t> Reader() const {
+    const char *Begin = nullptr;
+    const char *End = nullptr;
+    if (!Windows.Map(0, Begin, End)) {
+      Begin = End = nullptr;
+    }
+
+    return WindowedReader_t<Reader_t>(Windows, Begin, End);
+  }
+
+  uint64_t Size() const { return Windows.Size(); }
+};
+
+//
+// A trace file mapped one window at a time, walked from |Offset| which is in
+// the middle of it; |Previous| is the address of the record before.
+//
+
+struct WindowedChunkInput_t {
+  TraceWindows_t &Windows;
+  uint64_t Offset = 0;
+  uint64_t Previous = 0;
+
+  template <typename Reader_t> WindowedReader_t<Reader_t> Reader() const {
+    const char *Begin = nullptr;
+    const char *End = nullptr;
+    if (!Windows.Map(Offset, Begin, End)) {
+      Begin = End = nullptr;
+    }
+
+    WindowedReader_t<Reader_t> Reader(Windows, Begin, End);
+    Reader.Resume(Previous);
+    return Reader;
+  }
+
+  uint64_t Size() const { return Windows.Size() - Offset; }
+};
+
+struct RingInput_t {
+  RingTrace_t &Trace;
+
+  template <typename Reader_t> RingReader_t<Reader_t> Reader() const {
+    const char *Begin = nullptr;
+    const char *End = nullptr;
+    if (!Trace.Rewind() || !Trace.Next(nullptr, 0, Begin, End)) {
+      Begin = End = nullptr;
+    }
+
+    return RingReader_t<Reader_t>(Trace, Begin, End);
+  }
+
+  uint64_t Size() const { return Trace.Size(); }
+};
+
+//
+// Walk the trace |Input| according to its format, batch by batch.
+//
+
+template <typename Input_t, typename F_t>
+bool ForEachTraceBatch(const Opts_t &Opts, const Input_t &Input,
+                       F_t &&Callback) {
+  switch (Opts.Format) {
+  case TraceFormat_t::Raw64: {
+    return ForEachRecordBatch(Opts, Input.template Reader<Raw64Reader_t>(),
+                              Callback);
+  }
+
+  case TraceFormat_t::Compact: {
+    return ForEachRecordBatch(Opts, Input.template Reader<CompactReader_t>(),
+                              Callback);
+  }
+
+  case TraceFormat_t::Tenet: {
+    return ForEachRecordBatch(Opts, Input.template Reader<TenetReader_t>(),
+                              Callback);
+  }
+
+  case TraceFormat_t::Perf: {
+    return ForEachRecordBatch(Opts, Input.template Reader<PerfReader_t>(),
+                              Callback);
+  }
+
+  default: {
+    if (Opts.Columns.Column == 0) {
+      return ForEachRecordBatch(Opts, Input.template Reader<HexReader_t>(),
+                                Callback);
+    }
+
+    auto Reader = Input.template Reader<ColumnReader_t>();
+    Reader.Select(Opts.Columns);
+    return ForEachRecordBatch(Opts, Reader, Callback);
+  }
+  }
+}
+
+//
+// Walk the lines of the trace in [|Begin|, |End|) and invoke |Callback| with
+// the number, the address and the text of every line. The callback returns
+// true when it symbolized the line.
+//
+
+template <typename F_t>
+bool ForEachTraceLine(const Opts_t &Opts, const char *Begin, const char *End,
+                      F_t &&Callback) {
+  return ForEachTraceBatch(
+      Opts, BufferInput_t{Begin, End},
+      [&](const std::span<const TraceRecord_t> &Batch, const uint64_t) {
+        uint64_t NumberSymbolizedLines = 0;
+        for (const auto &Record : Batch) {
+          if (Callback(Record.LineNumber, Record.Address, Record.Line)) {
+            NumberSymbolizedLines++;
+          }
+        }
+
+        return NumberSymbolizedLines;
+      });
+}
+
+//
+// Render the text of the output line of |Address|, which resolved into |Info|,
+// according to the style of the run.
+//
+
+inline std::string RenderSymbol(const Opts_t &Opts, const uint64_t Address,
+                                const SymbolInfo_t &Info) {
+  if (Opts.Style == TraceStyle_t::Custom) {
+    return Opts.OutputFormat.Render(Address, Info);
+  }
+
+  return FormatSymbol(Address, Info, Opts.Style);
+}
+
+//
+// Resolve |Address| with |Dbg| into the text of its output line according to
+// the style of the run, without going through the cache.
+//
+
+template <typename Dbg_t>
+std::optional<std::string> ResolveAddress(Dbg_t &Dbg, const Opts_t &Opts,
+                                          const uint64_t Address) {
+  if (Opts.Style != TraceStyle_t::Custom) {
+    return Dbg.Resolve(Address, Opts.Style);
+  }
+
+  const auto &Info = Dbg.ResolveInfo(Address);
+  if (!Info.has_value()) {
+    return {};
+  }
+
+  return RenderSymbol(Opts, Address, *Info);
+}
+
+//
+// Same as above, but through the address cache of |Dbg|.
+//
+
+template <typename Dbg_t>
+std::optional<std::reference_wrapper<std::string>>
+SymbolizeAddress(Dbg_t &Dbg, const Opts_t &Opts, const uint64_t Address) {
+  if (Opts.Style != TraceStyle_t::Custom) {
+    return Dbg.Symbolize(Address, Opts.Style);
+  }
+
+  return Dbg.Cache().Symbolize(Address, [&](const uint64_t Address) {
+    return ResolveAddress(Dbg, Opts, Address);
+  });
+}
+
+//
+// Split |Line| around the field its address was read from, for
+// --passthrough.
+//
+
+inline void SplitAroundAddress(const Opts_t &Opts, const std::string_view Line,
+                               std::string_view &Before,
+                               std::string_view &After) {
+  const std::string_view Field = ColumnReader_t::Field(Line, Opts.Columns);
+  Before = Line.substr(0, Field.data() - Line.data());
+  After = Line.substr(Before.size() + Field.size());
+}
+
+//
+// Append the output line at |LineNumber| of the address symbolized into
+// |Symbol| into |Buffer|; |Line| is the line of the trace it comes from.
+//
+
+template <typename Buffer_t>
+void AppendLine(const Opts_t &Opts, Buffer_t &Buffer,
+                const uint64_t LineNumber, const std::string_view Line,
+                const std::string &Symbol) {
+  std::string_view Before;
+  std::string_view After;
+  if (Opts.Passthrough) {
+    SplitAroundAddress(Opts, Line, Before, After);
+  }
+
+  if (Opts.Style == TraceStyle_t::Custom) {
+    Buffer.append(Before.data(), Before.data() + Before.size());
+    Opts.OutputFormat.Append(Buffer, LineNumber, Symbol, After);
+    return;
+  }
+
+  if (Opts.LineNumbers) {
+    fmt::format_to(std::back_inserter(Buffer), "l{}: ", LineNumber);
+  }
+
+  if (!Opts.Passthrough) {
+    fmt::format_to(std::back_inserter(Buffer), "{}\n", Symbol);
+    return;
+  }
+
+  fmt::format_to(std::back_inserter(Buffer), "{}{}{}\n", Before, Symbol, After);
+}
+
+//
+// Returns the size of the line |AppendLine| would append.
+//
+
+inline uint64_t LineSize(const Opts_t &Opts, const uint64_t LineNumber,
+                         const std::string_view Line,
+                         const std::string &Symbol) {
+  uint64_t Size = 0;
+  if (Opts.Passthrough) {
+    std::string_view Before;
+    std::string_view After;
+    SplitAroundAddress(Opts, Line, Before, After);
+    Size += Before.size() + After.size();
+  }
+
+  if (Opts.Style == TraceStyle_t::Custom) {
+    return Size + Opts.OutputFormat.Size(LineNumber, Symbol);
+  }
+
+  Size += Symbol.size() + 1;
+  if (Opts.LineNumbers) {
+    Size += fmt::formatted_size("l{}: ", LineNumber);
+  }
+
+  return Size;
+}
+
+//
+// The symbols of the distinct addresses of a trace; the symbol of an address
+// is at its slot, and is empty if it couldn't be resolved.
+//
+
+struct DistinctSymbols_t {
+  AddressSlotMap_t SlotMap;
+  std::vector<std::optional<std::string>> Resolved;
+};
+
+//
+// Extract the distinct addresses of the trace |Input|. |Callback| is invoked
+// with every batch of records walked, and the offset the reader reached.
+// |HitMax| is set if there were lines left past --max.
+//
+
+template <typename Input_t, typename F_t>
+std::optional<std::vector<uint64_t>>
+ExtractDistinct(const Opts_t &Opts, const Input_t &Input, Stats_t &Stats,
+                bool &HitMax, F_t &&Callback) {
+  const fs::path SpillDir =
+      Opts.SpillDir.empty() ? fs::temp_directory_path() : Opts.SpillDir;
+  DistinctAddresses_t Distinct(Opts.DistinctBudget * 1'024 * 1'024, SpillDir,
+                               std::thread::hardware_concurrency());
+
+  bool Pushed = true;
+  HitMax = ForEachTraceBatch(
+      Opts, Input,
+      [&](const std::span<const TraceRecord_t> &Batch, const uint64_t Offset) {
+        for (const auto &Record : Batch) {
+          if (Pushed) {
+            Pushed = Distinct.Push(Record.Address);
+          }
+        }
+
+        Callback(Batch, Offset);
+        return Batch.size();
+      });
+
+  Stats.Memory.Index = std::max(Stats.Memory.Index, Distinct.MemoryUsage());
+  auto Addresses = Distinct.Finalize();
+  if (!Pushed) {
+    return {};
+  }
+
+  return Addresses;
+}
+
+template <typename Input_t>
+std::optional<std::vector<uint64_t>>
+ExtractDistinct(const Opts_t &Opts, const Input_t &Input, Stats_t &Stats) {
+  bool HitMax = false;
+  return ExtractDistinct(Opts, Input, Stats, HitMax,
+                         [](const std::span<const TraceRecord_t> &,
+                            const uint64_t) {});
+}
+
+//
+// Resolve the distinct |Addresses| in order with |Dbg|, bypassing its cache.
+//
+
+template <typename Dbg_t>
+DistinctSymbols_t ResolveDistinct(Dbg_t &Dbg, const Opts_t &Opts,
+                                  std::vector<uint64_t> &&Addresses,
+                                  Stats_t &Stats) {
+  DistinctSymbols_t Distinct{AddressSlotMap_t(std::move(Addresses)), {}};
+  Distinct.Resolved.reserve(Distinct.SlotMap.Size());
+  for (const uint64_t Address : Distinct.SlotMap.Addresses()) {
+    const auto &Before = chrono::steady_clock::now();
+    Distinct.Resolved.emplace_back(ResolveAddress(Dbg, Opts, Address));
+    Stats.Backend.Record(NanosecondsSince(Before));
+
+#ifdef SYMBOLIZER_INSTRUMENTATION
+    Instrumentation().Record(Latency_t::BackendResolve,
+                             NanosecondsSince(Before));
+    Instrumentation().Resolved(Address, Distinct.Resolved.back());
+#endif
+  }
+
+  uint64_t IndexBytes = Distinct.SlotMap.Size() * sizeof(uint64_t);
+  for (const auto &Symbol : Distinct.Resolved) {
+    IndexBytes += sizeof(Symbol) + (Symbol ? Symbol->capacity() : 0);
+  }
+
+  Stats.Memory.Index = std::max(Stats.Memory.Index, IndexBytes);
+  return Distinct;
+}
+
+//
+// Symbolize the trace |Input| into |Out| with |Dbg|, in the |Style| style,
+// with the line numbers if |LineNumbers| and the rest of the lines around the
+// symbols if |Passthrough|. |Name| is only used to report errors. The trace
+// is processed by batches of lines, one stage at a time, and the time spent in
+// every stage is accounted in |Stats|.
+// The progress is published into |Progress| once per batch, if there is one,
+// the hardware performance counters are attributed to every stage if
+// |PerfCounters| is set, and the lines are fanned out to |Sinks| if set.
+//
+
+template <TraceStyle_t Style, bool LineNumbers, bool Passthrough,
+          typename Dbg_t, typename Input_t>
+bool SymbolizeTraceAs(Dbg_t &Dbg, const Opts_t &Opts, const std::string &Name,
+                      const Input_t &Input, OutputSink_t &Out, Stats_t &Stats,
+                      Progress_t *Progress, PerfCounters_t *PerfCounters,
+                      Sinks_t *Sinks) {
+  const auto &Start = chrono::steady_clock::now();
+  const uint64_t BytesWrittenBefore = Out.BytesWritten();
+  const uint64_t WriteNsBefore = Out.WriteNs();
+
+  //
+  // Returns the time elapsed since the last lap.
+  //
+
+  auto Mark = Start;
+  const auto &Lap = [&]() {
+    const auto &Now = chrono::steady_clock::now();
+    const uint64_t Ns =
+        chrono::duration_cast<chrono::nanoseconds>(Now - Mark).count();
+    Mark = Now;
+    return Ns;
+  };
+
+  const auto &CountersLap = [&](const Stage_t Stage) {
+    if (PerfCounters != nullptr) {
+      PerfCounters->Lap(Stage);
+    }
+  };
+
+  if (PerfCounters != nullptr) {
+    PerfCounters->Skip();
+  }
+
+  //
+  // Write a symbolized line into the output trace.
+  //
+
+  const auto &WriteLine = [&](const TraceRecord_t &Record,
+                              const std::string &Symbolized) {
+    const uint64_t LineNumber = Record.LineNumber;
+
+    //
+    // Keep the rest of the line around the symbol if asked to.
+    //
+
+    std::string_view Before;
+    std::string_view After;
+    if constexpr (Passthrough) {
+      SplitAroundAddress(Opts, Record.Line, Before, After);
+    }
+
+    //
+    // Include the line numbers; with an output format, they are fields of the
+    // format.
+    //
+
+    if constexpr (Style == TraceStyle_t::Custom) {
+      if constexpr (LineNumbers || Passthrough) {
+        Out.Buffer().append(Before.data(), Before.data() + Before.size());
+        Opts.OutputFormat.Append(Out.Buffer(), LineNumber, Symbolized, After);
+        return;
+      }
+    } else if constexpr (LineNumbers) {
+      Out.Append("l{}: ", LineNumber);
+    }
+
+    //
+    // Write the symbolized address into the output trace.
+    //
+
+    if constexpr (Passthrough) {
+      Out.Append("{}{}{}\n", Before, Symbolized, After);
+    } else {
+      Out.Append("{}\n", Symbolized);
+    }
+  };
+
+  //
+  // Fold the loops of the output trace if asked to.
+  //
+
+  std::optional<LoopFolder_t> Folder;
+  if (Opts.FoldLoops > 0) {
+    Folder.emplace(Opts.FoldLoops);
+  }
+
+  uint64_t NumberSymbolizedLines = 0;
+  uint64_t NumberFailedSymbolization = 0;
+  const auto &SymbolizationFailed = [&](const TraceRecord_t &Record) {
+    if (Folder) {
+      Folder->Flush(Out.Buffer());
+    }
+
+    //
+    // The lines written on stdout go before the message.
+    //
+
+    if (Out.IsStdout()) {
+      Out.Flush();
+    }
+
+    fmt::print("{}:{}: Symbolization of {} failed ('{}'), skipping\n", Name,
+               Record.LineNumber, Record.Address, Record.Line);
+    NumberFailedSymbolization++;
+  };
+
+  //
+  // Walk the trace and symbolize every batch with |Symbolize|, which returns
+  // the symbol of an address or nullptr if it failed. Then, write the batch
+  // into the output trace.
+  //
+
+  std::vector<const std::string *> Symbols(TraceBatchSize);
+  const auto &SymbolizeBatches = [&](auto &&Symbolize) {
+    return ForEachTraceBatch(
+        Opts, Input,
+        [&](const std::span<const TraceRecord_t> &Batch,
+            const uint64_t Offset) {
+#ifdef SYMBOLIZER_INSTRUMENTATION
+          Instrumentation().DumpIfRequested();
+#endif
+
+          Stats.ParseNs += Lap();
+          CountersLap(Stage_t::Parse);
+          for (size_t Idx = 0; Idx < Batch.size(); Idx++) {
+            Symbols[Idx] = Symbolize(Batch[Idx].Address);
+          }
+
+          Stats.SymbolizeNs += Lap();
+          CountersLap(Stage_t::Symbolize);
+          uint64_t NumberSymbolizedBatch = 0;
+          for (size_t Idx = 0; Idx < Batch.size(); Idx++) {
+            if (Symbols[Idx] == nullptr) {
+              SymbolizationFailed(Batch[Idx]);
+              continue;
+            }
+
+            const size_t Begin = Out.Buffer().size();
+            WriteLine(Batch[Idx], *Symbols[Idx]);
+            if (Folder) {
+              Folder->Push(Batch[Idx].Address, Out.Buffer(), Begin);
+            }
+
+            NumberSymbolizedBatch++;
+          }
+
+          Stats.FormatNs += Lap();
+          CountersLap(Stage_t::Format);
+
+          //
+          // We are done with the symbols of the batch, so the cache can evict
+          // entries if it is over budget.
+          //
+
+          Dbg.Cache().Trim();
+          Stats.SymbolizeNs += Lap();
+          CountersLap(Stage_t::Symbolize);
+
+          //
+          // The time spent writing is accounted by the sink itself.
+          //
+
+          Out.FlushIfFull();
+          Lap();
+          CountersLap(Stage_t::Write);
+          NumberSymbolizedLines += NumberSymbolizedBatch;
+          if (Progress != nullptr) {
+            Progress->Publish(Offset, NumberSymbolizedBatch,
+                              Dbg.Cache().Hits(), Dbg.Cache().Misses());
+          }
+
+          return NumberSymbolizedBatch;
+        });
+  };
+
+  //
+  // Symbolize an address through the cache.
+  //
+
+  const auto &SymbolizeCached = [&](const uint64_t Address) {
+    const auto &AddressSymbolized = [&]() {
+      if constexpr (Style == TraceStyle_t::Custom) {
+        return SymbolizeAddress(Dbg, Opts, Address);
+      } else {
+        return Dbg.Symbolize(Address, Style);
+      }
+    }();
+    return AddressSymbolized.has_value() ? &AddressSymbolized->get()
+                                         : (const std::string *)nullptr;
+  };
+
+  //
+  // Symbolize an address through the cache and fan its line out to the sinks.
+  // On a cache miss, the address is resolved once for the output trace and
+  // for all the sinks.
+  //
+
+  const auto &SymbolizeSinks = [&](const uint64_t Address) {
+    const auto &Symbol = Dbg.Cache().Symbolize(
+        Address, [&](const uint64_t Address) -> std::optional<std::string> {
+          const auto &Info = Dbg.ResolveInfo(Address);
+          if (!Info.has_value()) {
+            return {};
+          }
+
+          Sinks->Add(Address, *Info);
+          return RenderSymbol(Opts, Address, *Info);
+        });
+
+    if (!Symbol.has_value()) {
+      return (const std::string *)nullptr;
+    }
+
+    Sinks->Hit(Address);
+    return (const std::string *)&Symbol->get();
+  };
+
+  bool HitMax = false;
+  if (Sinks != nullptr) {
+    HitMax = SymbolizeBatches(SymbolizeSinks);
+  } else if (!Opts.Distinct) {
+
+    //
+    // Read the trace file line by line and symbolize the addresses through
+    // the cache.
+    //
+
+    HitMax = SymbolizeBatches(SymbolizeCached);
+  } else {
+
+    //
+    // Extract the distinct addresses of the trace, and resolve them.
+    //
+
+    auto Addresses = ExtractDistinct(Opts, Input, Stats);
+    Stats.ParseNs += Lap();
+    CountersLap(Stage_t::Parse);
+    if (!Addresses.has_value()) {
+      fmt::print("Could not extract the distinct addresses of {}\n", Name);
+      return false;
+    }
+
+    DistinctSymbols_t Distinct =
+        ResolveDistinct(Dbg, Opts, std::move(*Addresses), Stats);
+    Stats.SymbolizeNs += Lap();
+    CountersLap(Stage_t::Symbolize);
+
+    //
+    // Now, write the output trace. If a failed symbolization made us walk
+    // past the lines seen during the extraction (as --max only counts
+    // symbolized lines), fall back to the cache.
+    //
+
+    HitMax = SymbolizeBatches([&](const uint64_t Address) {
+      const auto &Slot = Distinct.SlotMap.Lookup(Address);
+      if (!Slot.has_value()) {
+        return SymbolizeCached(Address);
+      }
+
+      const auto &Symbol = Distinct.Resolved[*Slot];
+      return Symbol.has_value() ? &*Symbol : (const std::string *)nullptr;
+    });
+  }
+
+  if (Folder) {
+    Folder->Flush(Out.Buffer());
+    Stats.NumberFoldedLines += Folder->Folded();
+  }
+
+  Out.Flush();
+  CountersLap(Stage_t::Write);
+  if (HitMax) {
+    fmt::print("Hit the maximum number of symbolized lines {}, exiting\n",
+               NumberToHuman(Opts.Max));
+  }
+
+  //
+  // Account the file in the stats.
+  //
+
+  FileStats_t File;
+  File.Name = Name;
+  File.NumberSymbolizedLines = NumberSymbolizedLines;
+  File.NumberFailedSymbolization = NumberFailedSymbolization;
+  File.BytesRead = Input.Size();
+  File.BytesWritten = Out.BytesWritten() - BytesWrittenBefore;
+  File.Ns = NanosecondsSince(Start);
+  Stats.Memory.Buffers =
+      std::max(Stats.Memory.Buffers,
+               Out.MemoryUsage() + (Symbols.capacity() * sizeof(Symbols[0])) +
+                   (TraceBatchSize * sizeof(TraceRecord_t)));
+  Stats.NumberSymbolizedLines += NumberSymbolizedLines;
+  Stats.NumberFailedSymbolization += NumberFailedSymbolization;
+  Stats.WriteNs += Out.WriteNs() - WriteNsBefore;
+  Stats.BytesRead += File.BytesRead;
+  Stats.BytesWritten += File.BytesWritten;
+  Stats.Files.emplace_back(std::move(File));
+  return true;
+}
+
+//
+// Symbolize the addresses found anywhere in the lines of the text |Input| into
+// |Out|, for --scan: every address that resolves gets replaced by its symbol,
+// or annotated with it, and everything else goes through untouched. The
+// tokens that look like addresses but don't resolve are remembered, so that
+// the backend isn't asked about them again. --skip and --max count lines.
+//
+
+template <typename Dbg_t, typename Input_t>
+bool ScanTrace(Dbg_t &Dbg, const Opts_t &Opts, const std::string &Name,
+               const Input_t &Input, OutputSink_t &Out, Stats_t &Stats,
+               Progress_t *Progress = nullptr) {
+  const auto &Start = chrono::steady_clock::now();
+  const uint64_t BytesWrittenBefore = Out.BytesWritten();
+  const uint64_t WriteNsBefore = Out.WriteNs();
+  auto Mark = Start;
+  const auto &Lap = [&]() {
+    const auto &Now = chrono::steady_clock::now();
+    const uint64_t Ns =
+        chrono::duration_cast<chrono::nanoseconds>(Now - Mark).count();
+    Mark = Now;
+    return Ns;
+  };
+
+  //
+  // Like the trace loop, every batch is scanned for tokens first, then their
+  // addresses are symbolized in one go and finally the lines are written
+  // with the tokens replaced; |LineTokens| is where the tokens of every line
+  // start in |Tokens|.
+  //
+
+  struct Token_t {
+    size_t Begin = 0;
+    size_t End = 0;
+    uint64_t Address = 0;
+  };
+
+  const bool Annotate = Opts.Scan == ScanMode_t::Annotate;
+  std::vector<Token_t> Tokens;
+  std::vector<size_t> LineTokens;
+  std::vector<const std::string *> Symbols;
+  std::unordered_set<uint64_t> Unresolved;
+  uint64_t NumberLines = 0;
+  uint64_t NumberAddresses = 0;
+  const bool HitMax = ForEachRecordBatch(
+      Opts, Input.template Reader<LineReader_t>(),
+      [&](const std::span<const TraceRecord_t> &Batch, const uint64_t Offset) {
+        Tokens.clear();
+        LineTokens.clear();
+        for (const auto &Record : Batch) {
+          LineTokens.emplace_back(Tokens.size());
+          HexScanner_t::ForEachToken(
+              Record.Line, [&](const size_t Begin, const size_t End,
+                               const uint64_t Address) {
+                Tokens.emplace_back(Token_t{Begin, End, Address});
+              });
+        }
+
+        LineTokens.emplace_back(Tokens.size());
+        Stats.ParseNs += Lap();
+
+        Symbols.resize(Tokens.size());
+        for (size_t Idx = 0; Idx < Tokens.size(); Idx++) {
+          const uint64_t Address = Tokens[Idx].Address;
+          Symbols[Idx] = nullptr;
+          if (!Unresolved.empty() && Unresolved.contains(Address)) {
+            continue;
+          }
+
+          const auto &Symbol = Dbg.Symbolize(Address, Opts.Style);
+          if (!Symbol.has_value()) {
+            Unresolved.emplace(Address);
+            continue;
+          }
+
+          Symbols[Idx] = &Symbol->get();
+        }
+
+        Stats.SymbolizeNs += Lap();
+        auto &Buffer = Out.Buffer();
+        for (size_t Line = 0; Line < Batch.size(); Line++) {
+          const TraceRecord_t &Record = Batch[Line];
+          if (Opts.LineNumbers) {
+            Out.Append("l{}: ", Record.LineNumber);
+          }
+
+          const char *Text = Record.Line.data();
+          size_t Copied = 0;
+          for (size_t Idx = LineTokens[Line]; Idx < LineTokens[Line + 1];
+               Idx++) {
+            const std::string *Symbol = Symbols[Idx];
+            if (Symbol == nullptr) {
+              continue;
+            }
+
+            const Token_t &Token = Tokens[Idx];
+            Buffer.append(Text + Copied,
+                          Text + (Annotate ? Token.End : Token.Begin));
+            if (Annotate) {
+              Buffer.append(std::string_view(" ("));
+            }
+
+            Buffer.append(Symbol->data(), Symbol->data() + Symbol->size());
+            if (Annotate) {
+              Buffer.push_back(')');
+            }
+
+            Copied = Token.End;
+            NumberAddresses++;
+          }
+
+          Buffer.append(Text + Copied, Text + Record.Line.size());
+          Buffer.push_back('\n');
+        }
+
+        Stats.FormatNs += Lap();
+
+        //
+        // We are done with the symbols of the batch, so the cache can evict
+        // entries if it is over budget.
+        //
+
+        Dbg.Cache().Trim();
+        Stats.SymbolizeNs += Lap();
+        Out.FlushIfFull();
+        Lap();
+        NumberLines += Batch.size();
+        if (Progress != nullptr) {
+          Progress->Publish(Offset, Batch.size(), Dbg.Cache().Hits(),
+                            Dbg.Cache().Misses());
+        }
+
+        return Batch.size();
+      });
+
+  Out.Flush();
+  if (HitMax) {
+    fmt::print("Hit the maximum number of scanned lines {}, exiting\n",
+               NumberToHuman(Opts.Max));
+  }
+
+  //
+  // The addresses found are what got symbolized.
+  //
+
+  FileStats_t File;
+  File.Name = Name;
+  File.NumberSymbolizedLines = NumberAddresses;
+  File.BytesRead = Input.Size();
+  File.BytesWritten = Out.BytesWritten() - BytesWrittenBefore;
+  File.Ns = NanosecondsSince(Start);
+  Stats.Memory.Buffers = std::max(
+      Stats.Memory.Buffers,
+      Out.MemoryUsage() + (Tokens.capacity() * sizeof(Token_t)) +
+          (Symbols.capacity() * sizeof(Symbols[0])) +
+          (TraceBatchSize * sizeof(TraceRecord_t)));
+  Stats.NumberSymbolizedLines += NumberAddresses;
+  Stats.NumberScannedLines += NumberLines;
+  Stats.WriteNs += Out.WriteNs() - WriteNsBefore;
+  Stats.BytesRead += File.BytesRead;
+  Stats.BytesWritten += File.BytesWritten;
+  Stats.Files.emplace_back(std::move(File));
+  return true;
+}
+
+//
+// Symbolize the trace |Input| into |Out|; see above. The per-line loop is
+// instantiated for every trace style, line numbers and passthrough mode (the
+// input format is already a template parameter of the readers) and the right
+// one is picked
+// once per trace, so that the loop doesn't test the options on every line.
+//
+
+template <typename Dbg_t, typename Input_t>
+bool SymbolizeTrace(Dbg_t &Dbg, const Opts_t &Opts, const std::string &Name,
+                    const Input_t &Input, OutputSink_t &Out, Stats_t &Stats,
+                    Progress_t *Progress = nullptr,
+                    PerfCounters_t *PerfCounters = nullptr,
+                    Sinks_t *Sinks = nullptr) {
+  if (Opts.Scan != ScanMode_t::Off) {
+    return ScanTrace(Dbg, Opts, Name, Input, Out, Stats, Progress);
+  }
+
+  const auto &SymbolizeAs = [&]<TraceStyle_t Style, bool LineNumbers>() {
+    return Opts.Passthrough
+               ? SymbolizeTraceAs<Style, LineNumbers, true>(
+                     Dbg, Opts, Name, Input, Out, Stats, Progress,
+                     PerfCounters, Sinks)
+               : SymbolizeTraceAs<Style, LineNumbers, false>(
+                     Dbg, Opts, Name, Input, Out, Stats, Progress,
+                     PerfCounters, Sinks);
+  };
+
+  const auto &Symbolize = [&]<TraceStyle_t Style>(const bool LineNumbers) {
+    return LineNumbers ? SymbolizeAs.template operator()<Style, true>()
+                       : SymbolizeAs.template operator()<Style, false>();
+  };
+
+  switch (Opts.Style) {
+  case TraceStyle_t::Modoff: {
+    return Symbolize.template operator()<TraceStyle_t::Modoff>(
+        Opts.LineNumbers);
+  }
+
+  case TraceStyle_t::Custom: {
+    return Symbolize.template operator()<TraceStyle_t::Custom>(
+        Opts.OutputFormat.HasLineNumbers());
+  }
+
+  default: {
+    return Symbolize.template operator()<TraceStyle_t::FullSymbol>(
+        Opts.LineNumbers);
+  }
+  }
+}
+
+//
+// Symbolize the trace in [|Begin|, |End|).
+//
+
+template <typename Dbg_t>
+bool SymbolizeBuffer(Dbg_t &Dbg, const Opts_t &Opts, const std::string &Name,
+                     const char *Begin, const char *End, OutputSink_t &Out,
+                     Stats_t &Stats, Progress_t *Progress = nullptr,
+                     PerfCounters_t *PerfCounters = nullptr) {
+  return SymbolizeTrace(Dbg, Opts, Name, BufferInput_t{Begin, End}, Out, Stats,
+                        Progress, PerfCounters);
+}
+
+//
+// A chunk of a trace symbolized by a thread in parallel mode. It starts at
+// |Offset| in the trace file with the line |LineNumber|, and |Previous| is the
+// address of the record before it (compact traces are delta encoded). It
+// spans |Records| records once the first |Skip| have been skipped, and ends
+// at |End|. Once it has been sized, it outputs |Lines| lines taking |Bytes|
+// bytes at |OutputOffset| in the output file, and |Failures| are the messages
+// of the lines that couldn't be symbolized.
+//
+
+struct TraceChunk_t {
+  uint64_t Offset = 0;
+  uint64_t End = 0;
+  uint64_t LineNumber = 0;
+  uint64_t Previous = 0;
+  uint64_t Skip = 0;
+  uint64_t Records = 0;
+  uint64_t Lines = 0;
+  uint64_t Bytes = 0;
+  uint64_t OutputOffset = 0;
+  std::vector<std::string> Failures;
+};
+
+//
+// Walk the records of |Chunk| of the trace at |Path| and invoke |Callback|
+// with every one of them; their line numbers are relative to the start of the
+// trace.
+//
+
+template <typename F_t>
+bool ForEachChunkRecord(const Opts_t &Opts, const fs::path &Path,
+                        const uint64_t WindowSize, const MapHints_t &Hints,
+                        const TraceChunk_t &Chunk, F_t &&Callback) {
+
+  //
+  // The windows don't need to be larger than the chunk; a window starts at
+  // an aligned offset, so leave room for the alignment.
+  //
+
+  constexpr uint64_t AlignmentSlack = 64 * 1'024;
+  TraceWindows_t Windows;
+  if (!Windows.Open(Path,
+                    std::min(WindowSize,
+                             Chunk.End - Chunk.Offset + AlignmentSlack),
+                    Hints)) {
+    return false;
+  }
+
+  Opts_t ChunkOpts = Opts;
+  ChunkOpts.Skip = Chunk.Skip;
+  ChunkOpts.Max = Chunk.Records;
+  ForEachTraceBatch(
+      ChunkOpts, WindowedChunkInput_t{Windows, Chunk.Offset, Chunk.Previous},
+      [&](const std::span<const TraceRecord_t> &Batch, const uint64_t) {
+        for (TraceRecord_t Record : Batch) {
+          Record.LineNumber += Chunk.LineNumber;
+          Callback(Record);
+        }
+
+        return Batch.size();
+      });
+
+  return true;
+}
+
+//
+// Symbolize the trace file |Input| into the output file |Output| on
+// --jobs threads. Funnelling the lines of every thread through a single
+// writer would serialize them again, so this goes the other way around:
+//   - The distinct addresses of the trace are extracted and resolved with
+//   |Dbg| (the only part that runs on a single thread, as the backends aren't
+//   thread safe), and the trace gets cut in chunks along the way,
+//   - The threads compute how large the output of every chunk is, which gives
+//   the offset where every chunk goes in the output file,
+//   - The output file is preallocated, and the threads format the chunks and
+//   write them at their offsets.
+// The output is the same as when symbolizing on a single thread. If failed
+// symbolizations made the chunks come short of --max, the rest of the trace
+// is symbolized on the calling thread at the end of the output file. With a
+// |Pack|, the output is appended to it as |Output| instead: the space of the
+// chunks is reserved in one go, and the threads write into it the same way.
+//
+
+template <typename Dbg_t>
+bool SymbolizeTraceParallel(Dbg_t &Dbg, const Opts_t &Opts,
+                            const std::string &Name, const fs::path &Input,
+                            const fs::path &Output, const uint64_t WindowSize,
+                            MapHints_t Hints, Stats_t &Stats,
+                            Progress_t *Progress = nullptr,
+                            PackWriter_t *Pack = nullptr) {
+  const auto &Start = chrono::steady_clock::now();
+  auto Mark = Start;
+  const auto &Lap = [&]() {
+    const auto &Now = chrono::steady_clock::now();
+    const uint64_t Ns =
+        chrono::duration_cast<chrono::nanoseconds>(Now - Mark).count();
+    Mark = Now;
+    return Ns;
+  };
+
+  //
+  // The trace is walked several times, so keep it in the page cache.
+  //
+
+  Hints.DropBehind = false;
+  TraceWindows_t Windows;
+  if (!Windows.Open(Input, WindowSize, Hints)) {
+    return false;
+  }
+
+  //
+  // Extract the distinct addresses and cut the trace in chunks at batch
+  // boundaries. There are a few chunks per thread so that the threads that
+  // get the cheaper chunks pick up more of them. |Tail| is where the walk
+  // stopped.
+  //
+
+  constexpr uint64_t MinChunkSize = 4 * 1'024 * 1'024;
+  const uint32_t Jobs = std::max(Opts.Jobs, 1u);
+  const uint64_t ChunkSize =
+      std::max(Windows.Size() / (4 * uint64_t(Jobs)), MinChunkSize);
+  std::vector<TraceChunk_t> Chunks(1);
+  Chunks.front().Skip = Opts.Skip;
+  TraceChunk_t Tail;
+  bool HitMax = false;
+  auto Addresses = ExtractDistinct(
+      Opts, WindowedInput_t{Windows}, Stats, HitMax,
+      [&](const std::span<const TraceRecord_t> &Batch, const uint64_t Offset) {
+        TraceChunk_t &Chunk = Chunks.back();
+        Chunk.Records += Batch.size();
+        Chunk.End = Offset;
+        Tail.Offset = Tail.End = Offset;
+        Tail.LineNumber = Batch.back().LineNumber + 1;
+        Tail.Previous = Batch.back().Address;
+        if (Offset - Chunk.Offset >= ChunkSize) {
+          Chunks.emplace_back(Tail);
+        }
+      });
+
+  if (Chunks.back().Records == 0) {
+    Chunks.pop_back();
+  }
+
+  Stats.ParseNs += Lap();
+  if (!Addresses.has_value()) {
+    fmt::print("Could not extract the distinct addresses of {}\n", Name);
+    return false;
+  }
+
+  const DistinctSymbols_t Distinct =
+      ResolveDistinct(Dbg, Opts, std::move(*Addresses), Stats);
+  Stats.SymbolizeNs += Lap();
+
+  //
+  // Returns the symbol of |Address|, or nullptr if it couldn't be resolved.
+  // Every thread has its own lookup hint.
+  //
+
+  const auto &Lookup = [&](const uint64_t Address, size_t &Hint) {
+    const auto &Slot = Distinct.SlotMap.Lookup(Address, Hint);
+    if (!Slot.has_value() || !Distinct.Resolved[*Slot].has_value()) {
+      return (const std::string *)nullptr;
+    }
+
+    return &*Distinct.Resolved[*Slot];
+  };
+
+  //
+  // Compute the output of |Chunk|, stopping after |Limit| lines.
+  //
+
+  const auto &SizeChunk = [&](TraceChunk_t &Chunk, const uint64_t Limit) {
+    Chunk.Lines = 0;
+    Chunk.Bytes = 0;
+    Chunk.Failures.clear();
+    uint64_t Records = 0;
+    size_t Hint = 0;
+    const bool Walked = ForEachChunkRecord(
+        Opts, Input, WindowSize, Hints, Chunk,
+        [&](const TraceRecord_t &Record) {
+          if (Chunk.Lines == Limit) {
+            return;
+          }
+
+          Records++;
+          const std::string *Symbol = Lookup(Record.Address, Hint);
+          if (Symbol == nullptr) {
+            Chunk.Failures.emplace_back(fmt::format(
+                "{}:{}: Symbolization of {} failed ('{}'), skipping", Name,
+                Record.LineNumber, Record.Address, Record.Line));
+            return;
+          }
+
+          Chunk.Bytes +=
+              LineSize(Opts, Record.LineNumber, Record.Line, *Symbol);
+          Chunk.Lines++;
+        });
+
+    Chunk.Records = Records;
+    return Walked;
+  };
+
+  std::atomic<size_t> NextChunk = 0;
+  std::atomic<bool> Failed = false;
+  const auto &ForEachChunk = [&](const auto &Callback) {
+    NextChunk = 0;
+    ParallelForChunks(std::min<size_t>(Jobs, Chunks.size()), [&](size_t) {
+      for (size_t Idx = NextChunk++; Idx < Chunks.size() && !Failed;
+           Idx = NextChunk++) {
+        if (!Callback(Chunks[Idx])) {
+          Failed = true;
+        }
+      }
+    });
+
+    return !Failed;
+  };
+
+  const uint64_t NoLimit = ~uint64_t(0);
+  if (!ForEachChunk([&](TraceChunk_t &Chunk) {
+        return SizeChunk(Chunk, NoLimit);
+      })) {
+    return false;
+  }
+
+  //
+  // --max counts the symbolized lines, so the chunk it falls into gets sized
+  // again up to it and the chunks after it are dropped.
+  //
+
+  uint64_t NumberSymbolizedLines = 0;
+  uint64_t NumberFailedSymbolization = 0;
+  uint64_t TotalBytes = 0;
+  for (size_t Idx = 0; Idx < Chunks.size(); Idx++) {
+    TraceChunk_t &Chunk = Chunks[Idx];
+    const uint64_t Left = Opts.Max - NumberSymbolizedLines;
+    if (Opts.Max > 0 && Chunk.Lines >= Left) {
+      if (Chunk.Lines > Left && !SizeChunk(Chunk, Left)) {
+        return false;
+      }
+
+      HitMax = HitMax || Chunk.Lines > Left || Idx + 1 < Chunks.size();
+      Chunks.resize(Idx + 1);
+    }
+
+    for (const auto &Failure : Chunk.Failures) {
+      fmt::print("{}\n", Failure);
+    }
+
+    Chunk.OutputOffset = TotalBytes;
+    TotalBytes += Chunk.Bytes;
+    NumberSymbolizedLines += Chunk.Lines;
+    NumberFailedSymbolization += Chunk.Failures.size();
+  }
+
+  Stats.FormatNs += Lap();
+
+  //
+  // Preallocate the output file (or reserve its space in the pack) and let
+  // every thread write its chunks.
+  //
+
+  PreallocatedFile_t Out;
+  PackEntry_t Entry{Output.string(), {}};
+  uint64_t Base = 0;
+  if (Pack != nullptr) {
+    Base = Pack->Reserve(TotalBytes);
+    Entry.Add(Base, TotalBytes);
+  } else if (!Out.Open(Output, TotalBytes)) {
+    return false;
+  }
+
+  const auto &WriteAt = [&](const uint64_t Offset, const char *Data,
+                            const size_t Size) {
+    return Pack != nullptr ? Pack->WriteAt(Base + Offset, Data, Size)
+                           : Out.WriteAt(Offset, Data, Size);
+  };
+
+  std::atomic<uint64_t> BytesConsumed = 0;
+  const uint64_t CacheHits = Dbg.Cache().Hits();
+  const uint64_t CacheMisses = Dbg.Cache().Misses();
+  if (!ForEachChunk([&](TraceChunk_t &Chunk) {
+        OutputBuffer_t Buffer;
+        uint64_t Offset = Chunk.OutputOffset;
+        bool Written = true;
+        const auto &Flush = [&]() {
+          Written = Written && WriteAt(Offset, Buffer.data(), Buffer.size());
+          Offset += Buffer.size();
+          Buffer.clear();
+        };
+
+        size_t Hint = 0;
+        const bool Walked = ForEachChunkRecord(
+            Opts, Input, WindowSize, Hints, Chunk,
+            [&](const TraceRecord_t &Record) {
+              const std::string *Symbol = Lookup(Record.Address, Hint);
+              if (Symbol == nullptr) {
+                return;
+              }
+
+              AppendLine(Opts, Buffer, Record.LineNumber, Record.Line, *Symbol);
+              if (Buffer.size() >= OutputSink_t::FlushThreshold) {
+                Flush();
+              }
+            });
+
+        Flush();
+        if (!Walked || !Written) {
+          return false;
+        }
+
+        if (Offset != Chunk.OutputOffset + Chunk.Bytes) {
+          fmt::print("The chunk at {:#x} of {} came out with an unexpected "
+                     "size\n",
+                     Chunk.Offset, Name);
+          return false;
+        }
+
+        if (Progress != nullptr) {
+          BytesConsumed += Chunk.End - Chunk.Offset;
+          Progress->Publish(BytesConsumed, Chunk.Lines, CacheHits, CacheMisses);
+        }
+
+        return true;
+      })) {
+    return false;
+  }
+
+  Stats.WriteNs += Lap();
+
+  //
+  // If failed symbolizations made us come short of --max, symbolize the rest
+  // of the trace through the cache like on a single thread.
+  //
+
+  if (HitMax && NumberSymbolizedLines < Opts.Max &&
+      Tail.Offset < Windows.Size()) {
+    Opts_t TailOpts = Opts;
+    TailOpts.Skip = 0;
+    TailOpts.Max = Opts.Max - NumberSymbolizedLines;
+    OutputBuffer_t Buffer;
+    uint64_t Offset = TotalBytes;
+    bool Written = true;
+    const auto &Flush = [&]() {
+      Written = Written && (Pack != nullptr
+                                ? Pack->Append(Entry, Buffer.data(),
+                                               Buffer.size())
+                                : Out.WriteAt(Offset, Buffer.data(),
+                                              Buffer.size()));
+      Offset += Buffer.size();
+      Buffer.clear();
+    };
+
+    size_t Hint = 0;
+    HitMax = ForEachTraceBatch(
+        TailOpts, WindowedChunkInput_t{Windows, Tail.Offset, Tail.Previous},
+        [&](const std::span<const TraceRecord_t> &Batch, const uint64_t) {
+          uint64_t NumberSymbolizedBatch = 0;
+          for (const auto &Record : Batch) {
+            const uint64_t LineNumber = Tail.LineNumber + Record.LineNumber;
+            const std::string *Symbol = nullptr;
+            const auto &Slot = Distinct.SlotMap.Lookup(Record.Address, Hint);
+            if (Slot.has_value()) {
+              const auto &Resolved = Distinct.Resolved[*Slot];
+              Symbol = Resolved.has_value() ? &*Resolved : nullptr;
+            } else {
+              const auto &Cached = SymbolizeAddress(Dbg, Opts, Record.Address);
+              Symbol = Cached.has_value() ? &Cached->get() : nullptr;
+            }
+
+            if (Symbol == nullptr) {
+              fmt::print("{}:{}: Symbolization of {} failed ('{}'), skipping\n",
+                         Name, LineNumber, Record.Address, Record.Line);
+              NumberFailedSymbolization++;
+              continue;
+            }
+
+            AppendLine(Opts, Buffer, LineNumber, Record.Line, *Symbol);
+            NumberSymbolizedBatch++;
+          }
+
+          Dbg.Cache().Trim();
+          if (Buffer.size() >= OutputSink_t::FlushThreshold) {
+            Flush();
+          }
+
+          NumberSymbolizedLines += NumberSymbolizedBatch;
+          return NumberSymbolizedBatch;
+        });
+
+    Flush();
+    if (!Written) {
+      return false;
+    }
+
+    TotalBytes = Offset;
+    Stats.SymbolizeNs += Lap();
+  }
+
+  if (Pack != nullptr) {
+    Pack->Commit(std::move(Entry));
+  }
+
+  if (HitMax) {
+    fmt::print("Hit the maximum number of symbolized lines {}, exiting\n",
+               NumberToHuman(Opts.Max));
+  }
+
+  //
+  // Account the file in the stats.
+  //
+
+  FileStats_t File;
+  File.Name = Name;
+  File.NumberSymbolizedLines = NumberSymbolizedLines;
+  File.NumberFailedSymbolization = NumberFailedSymbolization;
+  File.BytesRead = Windows.Size();
+  File.BytesWritten = TotalBytes;
+  File.Ns = NanosecondsSince(Start);
+  Stats.Memory.Buffers =
+      std::max(Stats.Memory.Buffers,
+               (Jobs * 2 * OutputSink_t::FlushThreshold) +
+                   (Jobs * TraceBatchSize * sizeof(TraceRecord_t)) +
+                   (Chunks.capacity() * sizeof(TraceChunk_t)));
+  Stats.NumberSymbolizedLines += NumberSymbolizedLines;
+  Stats.NumberFailedSymbolization += NumberFailedSymbolization;
+  Stats.BytesRead += File.BytesRead;
+  Stats.BytesWritten += File.BytesWritten;
+  Stats.Files.emplace_back(std::move(File));
+  return true;
+}
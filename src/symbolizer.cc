@@ -1,320 +1,473 @@
 // Axel '0vercl0k' Souchet - September 11 2020
 // #define SYMBOLIZER_DEBUG
+// #define SYMBOLIZER_INSTRUMENTATION
 #define _CRT_SECURE_NO_WARNINGS
 
+#if defined(_WIN32)
 #include "dbgeng_t.h"
+#endif
+#include "symbol_map_t.h"
+#include "symbolize.h"
+#include "tar_archive_t.h"
+#include "utils.h"
 #include <CLI/CLI.hpp>
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
-#include <fmt/os.h>
 #include <fmt/printf.h>
 #include <optional>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
-#include <windows.h>
 
 namespace fs = std::filesystem;
 namespace chrono = std::chrono;
 
 //
-// Utility to call a cleaner on scope exit.
+// The globals.
 //
 
-template <typename F_t> struct Finally_t {
-  F_t f_;
-  Finally_t(F_t &&f) noexcept : f_(f) {}
-  ~Finally_t() noexcept { f_(); }
-};
-
-template <typename F_t> [[nodiscard]] auto finally(F_t &&f) noexcept {
-  return Finally_t(std::move(f));
-}
+Opts_t Opts;
+Stats_t Stats;
+std::optional<Progress_t> Progress;
+std::optional<PerfCounters_t> PerfCounters;
+std::optional<Sinks_t> Sinks;
+std::optional<PackWriter_t> Pack;
+std::optional<TarArchive_t> Archive;
 
 //
-// Utilities made to display seconds / numbers in a 'cleaner' way (w/ a unit,
-// etc.).
+// An input trace: a file, or a member of the archive if there is one.
 //
 
-struct SecondsHuman_t {
-  double Value;
-  const char *Unit;
+struct InputTrace_t {
+  fs::path Path;
+  uint64_t Size = 0;
 };
 
-struct NumberHuman_t {
-  double Value;
-  const char *Unit;
-};
+//
+// The traces smaller than this are read in one go instead of being mapped;
+// for a trace of a few lines, setting up and tearing down the mapping costs
+// more than symbolizing it.
+//
 
-template <> struct fmt::formatter<NumberHuman_t> : fmt::formatter<std::string> {
-  template <typename FormatContext>
-  auto format(const NumberHuman_t &Number, FormatContext &Ctx) const
-      -> decltype(Ctx.out()) {
-    return fmt::format_to(Ctx.out(), "{:.1f}{}", Number.Value, Number.Unit);
-  }
-};
+constexpr uint64_t SmallTraceSize = 1'024 * 1'024;
 
-template <>
-struct fmt::formatter<SecondsHuman_t> : fmt::formatter<std::string> {
-  template <typename FormatContext>
-  auto format(const SecondsHuman_t &Micro, FormatContext &Ctx) const
-      -> decltype(Ctx.out()) {
-    return fmt::format_to(Ctx.out(), "{:.1f}{}", Micro.Value, Micro.Unit);
-  }
+//
+// What symbolizing a trace needs that gets reused from one trace to the next:
+// the output sink (and so its buffer) and the buffer small traces are read
+// into.
+//
+
+struct Scratch_t {
+  OutputSink_t Out;
+  std::vector<char> Trace;
 };
 
-[[nodiscard]] constexpr NumberHuman_t NumberToHuman(const uint64_t N_) {
-  const char *Unit = "";
-  double N = double(N_);
-  const uint64_t K = 1'000;
-  const uint64_t M = K * K;
-  if (N > M) {
-    Unit = "m";
-    N /= M;
-  } else if (N > K) {
-    Unit = "k";
-    N /= K;
+//
+// Read the trace file |Input| of |Size| bytes into |Buffer|.
+//
+
+bool ReadTrace(const fs::path &Input, const uint64_t Size,
+               std::vector<char> &Buffer) {
+  FILE *File = fopen(Input.string().c_str(), "rb");
+  if (File == nullptr) {
+    fmt::print("Could not open {}\n", Input.string());
+    return false;
   }
 
-  return {N, Unit};
-}
+  Buffer.resize(Size);
+  const bool Read = fread(Buffer.data(), 1, Size, File) == Size;
+  fclose(File);
+  if (!Read) {
+    fmt::print("Could not read {}\n", Input.string());
+  }
 
-[[nodiscard]] constexpr SecondsHuman_t
-SecondsToHuman(const chrono::seconds &Seconds) {
-  const char *Unit = "s";
-  double SecondNumber = double(Seconds.count());
-  const double M = 60;
-  const double H = M * 60;
-  const double D = H * 24;
-  if (SecondNumber >= D) {
-    Unit = "d";
-    SecondNumber /= D;
-  } else if (SecondNumber >= H) {
-    Unit = "hr";
-    SecondNumber /= H;
-  } else if (SecondNumber >= M) {
-    Unit = "min";
-    SecondNumber /= M;
-  }
-
-  return {SecondNumber, Unit};
+  return Read;
 }
 
 //
-// Utility to calculate how many seconds since a past time point.
+// Symbolize the |Input| into |Output|.
 //
 
-[[nodiscard]] chrono::seconds
-SecondsSince(const chrono::high_resolution_clock::time_point &Since) {
-  const auto &Now = chrono::high_resolution_clock::now();
-  return chrono::duration_cast<chrono::seconds>(Now - Since);
-}
+template <typename Dbg_t>
+bool SymbolizeFile(Dbg_t &Dbg, const InputTrace_t &Input,
+                   const fs::path &Output, Scratch_t &Scratch) {
+  const std::string Name = Input.Path.filename().string();
+  PerfCounters_t *Counters = PerfCounters ? &*PerfCounters : nullptr;
+  Sinks_t *LineSinks = Sinks ? &*Sinks : nullptr;
+  PackWriter_t *OutputPack = Pack ? &*Pack : nullptr;
+  OutputSink_t &Out = Scratch.Out;
 
-//
-// The various commad line options that Symbolizer supports.
-//
+  //
+  // Symbolize the trace in [|Begin|, |End|) into the output.
+  //
 
-struct Opts_t {
+  const auto &SymbolizeBuffer = [&](const char *Begin, const char *End) {
+    Out.Open(Output, Opts.IoEngine, OutputPack);
+    const bool Symbolized = SymbolizeTrace(
+        Dbg, Opts, Name, BufferInput_t{Begin, End}, Out, Stats,
+        Progress ? &*Progress : nullptr, Counters, LineSinks);
+    const bool Written = Out.Close();
+    return Symbolized && Written;
+  };
 
   //
-  // The input path can be:
-  //   - A path to a directory full of traces to symbolize,
-  //   - A path to an input trace to symbolize.
+  // The members of an archive are symbolized in place, straight from its
+  // mapping.
   //
 
-  fs::path Input;
+  if (Archive) {
+    const TarMember_t *Member = Archive->Find(Input.Path.generic_string());
+    if (Member == nullptr) {
+      return false;
+    }
+
+    const char *Begin = Member->Data.data();
+    return SymbolizeBuffer(Begin, Begin + Member->Data.size());
+  }
 
   //
-  // The output path can be:
-  //   - A path to a directory where the output trace(s) are going to be written
-  //   into,
-  //   - A path to an output file where the output trace is going to be written
-  //   into,
-  //   - Empty if the output is to be dumped on stdout.
+  // Small traces are read into the scratch buffer.
   //
 
-  fs::path Output;
+  if (Input.Size < SmallTraceSize) {
+    if (!ReadTrace(Input.Path, Input.Size, Scratch.Trace)) {
+      return false;
+    }
+
+    const char *Begin = Scratch.Trace.data();
+    return SymbolizeBuffer(Begin, Begin + Scratch.Trace.size());
+  }
 
   //
-  // This is the path to the crash-dump to load.
+  // With io_uring, the input trace file is read block by block and the output
+  // written asynchronously.
   //
 
-  fs::path CrashdumpPath;
+  if (Opts.IoEngine == IoEngine_t::IoUring) {
+    RingTrace_t Trace;
+    if (!Trace.Open(Input.Path)) {
+      return false;
+    }
+
+    Out.Open(Output, Opts.IoEngine, OutputPack);
+    const bool Symbolized = SymbolizeTrace(
+        Dbg, Opts, Name, RingInput_t{Trace}, Out, Stats,
+        Progress ? &*Progress : nullptr, Counters, LineSinks);
+    const bool Written = Out.Close();
+    return Symbolized && Written;
+  }
 
   //
-  // Skip a number of lines.
+  // Otherwise, the input trace file gets mapped one window at a time.
   //
 
-  uint64_t Skip = 0;
+  const uint64_t WindowSize = Opts.WindowSize > 0
+                                  ? Opts.WindowSize * 1'024 * 1'024
+                                  : TraceWindows_t::DefaultWindowSize;
+  MapHints_t Hints;
+  Hints.Populate = Opts.Populate;
+  Hints.HugePages = Opts.HugePages;
 
   //
-  // The maximum amount of lines to process per file.
+  // With --distinct, the trace is walked twice, so keep it in the page cache.
   //
 
-  uint64_t Max = 0;
+  Hints.DropBehind = !Opts.Distinct;
 
   //
-  // This is the style used to output traces.
+  // With --jobs, chunks of the trace are symbolized and written into the
+  // output file in parallel.
   //
 
-  TraceStyle_t Style = TraceStyle_t::FullSymbol;
+  if (Opts.Jobs > 0 && !Output.empty()) {
+    return SymbolizeTraceParallel(Dbg, Opts, Name, Input.Path, Output,
+                                  WindowSize, Hints, Stats,
+                                  Progress ? &*Progress : nullptr, OutputPack);
+  }
+
+  TraceWindows_t Windows;
+  if (!Windows.Open(Input.Path, WindowSize, Hints)) {
+    return false;
+  }
 
   //
-  // Allow symbolizer to overwrite output traces.
+  // Open the output trace file; if we are not dumping data on stdout, then
+  // let's actually open an output file.
   //
 
-  bool Overwrite = false;
+  Out.Open(Output, IoEngine_t::Blocking, OutputPack);
 
   //
-  // Include line numbers in the output traces.
+  // Symbolize the trace.
   //
 
-  bool LineNumbers = false;
-};
+  const bool Symbolized = SymbolizeTrace(
+      Dbg, Opts, Name, WindowedInput_t{Windows}, Out, Stats,
+      Progress ? &*Progress : nullptr, Counters, LineSinks);
+  const bool Written = Out.Close();
+  return Symbolized && Written;
+}
 
 //
-// Various stats we keep track of.
+// Enumerate the files in |Directory|. Getting the size of a file is a
+// syscall of its own on most systems, so with a lot of files they are
+// fetched by a few threads.
 //
 
-struct Stats_t {
-  uint64_t NumberSymbolizedLines = 0;
-  uint64_t NumberFailedSymbolization = 0;
-  uint64_t NumberFiles = 0;
-};
+std::vector<InputTrace_t> EnumerateDirectory(const fs::path &Directory) {
+  std::vector<InputTrace_t> Inputs;
+  for (const auto &DirEntry : fs::directory_iterator(Directory)) {
+    if (DirEntry.is_regular_file()) {
+      Inputs.emplace_back(InputTrace_t{DirEntry.path(), 0});
+    }
+  }
 
-//
-// The globals.
-//
+  constexpr size_t FilesPerThread = 256;
+  const size_t NumberThreads = std::clamp<size_t>(
+      Inputs.size() / FilesPerThread, 1,
+      std::max(std::thread::hardware_concurrency(), 1u));
+  ParallelForChunks(NumberThreads, [&](const size_t Chunk) {
+    for (size_t Idx = Chunk; Idx < Inputs.size(); Idx += NumberThreads) {
+      std::error_code Ec;
+      const uint64_t Size = fs::file_size(Inputs[Idx].Path, Ec);
+      Inputs[Idx].Size = Ec ? 0 : Size;
+    }
+  });
 
-Opts_t Opts;
-Stats_t Stats;
+  return Inputs;
+}
 
 //
-// Symbolize the |Input| into |Output|.
+// Symbolize the |Inputs| with |Dbg|. Returns false if one of them couldn't be
+// symbolized or written out.
 //
 
-bool SymbolizeFile(DbgEng_t &Dbg, const fs::path &Input,
-                   const fs::path &Output) {
+template <typename Dbg_t>
+bool SymbolizeFiles(Dbg_t &Dbg, const std::vector<InputTrace_t> &Inputs) {
   //
-  // Open the input trace file.
+  // Calculate a bunch of useful variables to take decisions later.
   //
 
-  HANDLE TraceFile =
-      CreateFileA(Input.string().c_str(), GENERIC_READ, FILE_SHARE_READ,
-                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  const bool OutputIsDirectory = fs::is_directory(Opts.Output);
+  const bool OutputDoesntExist = !fs::exists(Opts.Output);
+  const bool OutputIsFile = fs::is_regular_file(Opts.Output);
+  const bool OutputIsStdout = Opts.Output.empty();
 
-  if (TraceFile == INVALID_HANDLE_VALUE) {
-    fmt::print("Could not open input {}\n", Input.string());
-    return false;
-  }
+  //
+  // The outputs that already exist in the output directory are listed once
+  // up front rather than checked one by one.
+  //
 
-  auto CloseTraceFile = finally([&] { CloseHandle(TraceFile); });
+  std::unordered_set<std::string> ExistingOutputs;
+  if (OutputIsDirectory && !Pack) {
+    for (const auto &DirEntry : fs::directory_iterator(Opts.Output)) {
+      ExistingOutputs.emplace(DirEntry.path().filename().string());
+    }
+  }
 
-  HANDLE Mapping =
-      CreateFileMappingA(TraceFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  const auto &OutputExists = [&](const std::string &OutputName,
+                                 const fs::path &Output) {
+    return OutputIsDirectory && OutputName.find('/') == OutputName.npos
+               ? ExistingOutputs.contains(OutputName)
+               : fs::exists(Output);
+  };
 
-  if (Mapping == INVALID_HANDLE_VALUE) {
-    fmt::print("Could not create a mapping\n");
-    return false;
-  }
+  //
+  // The members of an archive are named after their path in it, as there
+  // might be several with the same file name in different directories.
+  //
 
-  auto CloseMapping = finally([&] { CloseHandle(Mapping); });
+  std::unordered_set<std::string> MemberNames;
 
-  PVOID View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
-  if (View == nullptr) {
-    fmt::print("Could not map a view of the mapping\n");
-    return false;
-  }
+  //
+  // Bound the address cache if asked to.
+  //
 
-  auto UnmapView = finally([&] { UnmapViewOfFile(View); });
+  Dbg.Cache().SetBudget(Opts.CacheBudget * 1'024 * 1'024);
 
   //
-  // Open the output trace file; if we are not dumping data on stdout, then
-  // let's actually open an output file.
+  // Start reporting the progress if asked to; it is tracked in bytes of input
+  // traces.
   //
 
-  const bool OutputIsStdout = Output.empty();
-  std::optional<fmt::v8::ostream> Out;
-  if (!OutputIsStdout) {
-    Out.emplace(fmt::output_file(Output.string()));
+  if (Opts.Progress) {
+    uint64_t TotalBytes = 0;
+    for (const auto &Input : Inputs) {
+      TotalBytes += Input.Size;
+    }
+
+    Progress.emplace(TotalBytes, Inputs.size(), chrono::seconds(1));
+    Progress->Start();
   }
 
   //
-  // Read the trace file line by line.
+  // Symbolize each files.
   //
 
-  uint64_t NumberSymbolizedLines = 0;
-  uint64_t NumberFailedSymbolization = 0;
-  char *Line = (char *)View;
-  char *LineFeed = nullptr;
-  for (uint64_t LineNumber = 0; (LineFeed = strchr(Line, '\n')) != nullptr;
-       LineNumber++) {
+  Scratch_t Scratch;
+  bool Success = true;
+  for (const auto &InputTrace : Inputs) {
+    const fs::path &Input = InputTrace.Path;
 
     //
-    // Do we have a max value, and if so have we hit it yet?
+    // If we run symbolizer from the same directory for both inputs and outputs,
+    // we are going to see '.symbolizer' files into the input directory, so
+    // let's just keep them instead of bailing.
     //
 
-    if (Opts.Max > 0 && NumberSymbolizedLines >= Opts.Max) {
-      fmt::print("Hit the maximum number of symbolized lines {}, exiting\n",
-                 NumberToHuman(Opts.Max));
-      break;
+    if (Input.filename().string().ends_with(".symbolizer")) {
+      fmt::print("Skipping %s..\n", Input.string().c_str());
+      continue;
     }
 
     //
-    // Skipping a number of line.
+    // Work out the name of the output: the file name of the input, or the
+    // path of the member in the archive. The members that would end up
+    // outside of the output directory, or on top of another member, are
+    // errors.
     //
 
-    if (LineNumber < Opts.Skip) {
-      continue;
+    std::string Name = Input.filename().string();
+    if (Archive) {
+      const fs::path Member = Input.lexically_normal();
+      Name = Member.generic_string();
+      if (Member.has_root_path() || Member.empty() ||
+          Member.begin()->string() == "..") {
+        fmt::print("The member {} of the archive can't be written outside of "
+                   "the output directory, skipping\n",
+                   Input.string());
+        continue;
+      }
+
+      if (!MemberNames.emplace(Name).second) {
+        fmt::print("Several members of the archive are named {}, exiting\n",
+                   Name);
+        Success = false;
+        break;
+      }
     }
 
     //
-    // Convert the line into an address.
+    // Calculate the output path.
     //
 
-    const uint64_t Address = std::strtoull(Line, nullptr, 16);
-    Line = LineFeed + 1;
+    const std::string OutputName = fmt::format("{}.symbolizer", Name);
+    fs::path Output;
+    if (Pack) {
 
-    //
-    // Symbolize the address.
-    //
+      //
+      // With a pack, the outputs are named after their input.
+      //
 
-    auto AddressSymbolized = Dbg.Symbolize(Address, Opts.Style);
-    if (!AddressSymbolized.has_value()) {
-      fmt::print("{}:{}: Symbolization of {} failed ('{}'), skipping\n",
-                 Input.filename().string(), LineNumber, Address, Line);
-      NumberFailedSymbolization++;
-      continue;
+      Output = Name;
+    } else if (OutputIsDirectory) {
+
+      //
+      // If the output is a directory then generate an output file path; the
+      // directories of the members of an archive are created along the way.
+      //
+
+      Output = Opts.Output / OutputName;
+      if (Archive) {
+        std::error_code Ec;
+        fs::create_directories(Output.parent_path(), Ec);
+      }
+    } else if (OutputDoesntExist || OutputIsFile) {
+
+      //
+      // There are two cases to consider here:
+      //   - Either it is a path to a file that doesn't exist yet as we'll
+      //   create it,
+      //   - Or it points to an already existing file and the user might want to
+      //   overwrite it.
+      //
+
+      Output = Opts.Output;
+    } else {
+
+      //
+      // It is empty, data will be dumped on stdout.
+      //
     }
 
     //
-    // Include the line numbers.
+    // Verify that we are not about to overwrite an already generated trace
+    // file. If the user specify specify --overwrite we will overwrite the files
+    // that already exist.
     //
 
-    if (Opts.LineNumbers) {
-      if (OutputIsStdout) {
-        fmt::print("l{}: ", LineNumber);
-      } else {
-        Out->print("l{}: ", LineNumber);
+    if (!Pack && !OutputIsStdout && OutputExists(OutputName, Output)) {
+      if (!Opts.Overwrite) {
+        fmt::print("The output file {} already exists, continuing\n",
+                   Output.string());
+        continue;
       }
+
+      fmt::print("The output file {} will be overwritten..\n", Output.string());
     }
 
     //
-    // Write the symbolized address into the output trace.
+    // Process the file.
     //
 
-    if (OutputIsStdout) {
-      fmt::print("{}\n", AddressSymbolized->get());
+    if (!SymbolizeFile(Dbg, InputTrace, Output, Scratch)) {
+      fmt::print("Parsing {} failed, exiting\n", Input.string());
+      Success = false;
+      break;
+    }
+
+    if (OutputIsDirectory) {
+      ExistingOutputs.emplace(OutputName);
+    }
+
+    Stats.NumberFiles++;
+    if (Progress) {
+      Progress->FileDone(InputTrace.Size);
     } else {
-      Out->print("{}\n", AddressSymbolized->get());
+      fmt::print("[{} / {}] {} done\r", Stats.NumberFiles, Inputs.size(),
+                 Input.string());
     }
+  }
+
+  Progress.reset();
+
+  //
+  // The index of the pack goes at its end.
+  //
+
+  if (Pack) {
+    if (Pack->Close()) {
+      fmt::print("\nPacked {} outputs into {}", Pack->NumberEntries(),
+                 Opts.Output.string());
+    } else {
+      fmt::print("\nCould not write the index of {}", Opts.Output.string());
+      Success = false;
+    }
+  }
+
+  //
+  // The profiles are only known now that every trace has been symbolized.
+  //
 
-    NumberSymbolizedLines++;
+  if (Sinks) {
+    Sinks->Close();
+    Stats.Memory.Sinks = Sinks->MemoryUsage();
   }
 
-  Stats.NumberSymbolizedLines += NumberSymbolizedLines;
-  Stats.NumberFailedSymbolization += NumberFailedSymbolization;
-  return true;
+  //
+  // Grab the address cache stats.
+  //
+
+  Stats.CacheHits += Dbg.Cache().Hits();
+  Stats.CacheMisses += Dbg.Cache().Misses();
+  Stats.CacheEvictions += Dbg.Cache().Evictions();
+  Stats.Backend.Merge(Dbg.Cache().Backend());
+  Stats.Memory.Cache =
+      std::max(Stats.Memory.Cache, Dbg.Cache().PeakMemoryUsage());
+  return Success;
 }
 
 int main(int argc, char *argv[]) {
@@ -330,26 +483,62 @@ int main(int argc, char *argv[]) {
   Symbolizer.set_help_all_flag("--help-all", "Expand all help");
 
   Symbolizer
-      .add_option("-i,--input", Opts.Input, "Input trace file or directory")
+      .add_option("-i,--input", Opts.Input,
+                  "Input trace file, directory or tar archive")
       ->check(CLI::ExistingPath)
       ->required();
+  const auto &CrashdumpOption =
+      Symbolizer
+          .add_option("-c,--crash-dump", Opts.CrashdumpPath, "Crash-dump path")
+          ->check(CLI::ExistingFile);
   Symbolizer
-      .add_option("-c,--crash-dump", Opts.CrashdumpPath, "Crash-dump path")
+      .add_option("--symbol-map", Opts.SymbolMapPath,
+                  "Symbol map path (instead of a crash-dump)")
       ->check(CLI::ExistingFile)
-      ->required();
+      ->excludes(CrashdumpOption);
   Symbolizer.add_option("-o,--output", Opts.Output,
                         "Output trace (default: stdout)");
-  Symbolizer.add_option("-s,--skip", Opts.Skip, "Skip a number of lines")
-      ->default_val(0);
-  Symbolizer.add_option("-m,--max", Opts.Max, "Stop after a number of lines")
-      ->default_val(20'000'000);
+  const auto &SkipOption =
+      Symbolizer.add_option("-s,--skip", Opts.Skip, "Skip a number of lines")
+          ->default_val(0);
+  const auto &MaxOption =
+      Symbolizer
+          .add_option("-m,--max", Opts.Max, "Stop after a number of lines")
+          ->default_val(20'000'000);
 
   const std::unordered_map<std::string, TraceStyle_t> TraceStypeMap = {
-      {"modoff", TraceStyle_t::Modoff}, {"fullsym", TraceStyle_t::FullSymbol}};
+      {"modoff", TraceStyle_t::Modoff},
+      {"fullsym", TraceStyle_t::FullSymbol},
+      {"jsonl", TraceStyle_t::Jsonl}};
+
+  const auto &StyleOption =
+      Symbolizer.add_option("--style", Opts.Style, "Trace style")
+          ->transform(CLI::CheckedTransformer(TraceStypeMap, CLI::ignore_case))
+          ->default_val("fullsym");
 
-  Symbolizer.add_option("--style", Opts.Style, "Trace style")
-      ->transform(CLI::CheckedTransformer(TraceStypeMap, CLI::ignore_case))
-      ->default_val("fullsym");
+  std::string OutputFormat;
+  Symbolizer
+      .add_option("--format", OutputFormat,
+                  "Output format, such as '{mod}!{sym}+{disp:#x}' (fields: "
+                  "addr, mod, base, off, sym, disp, line)")
+      ->excludes(StyleOption);
+
+  std::vector<std::string> SinkSpecs;
+  Symbolizer.add_option(
+      "--sink", SinkSpecs,
+      "Also write the lines into a sink, as KIND=PATH with KIND in fullsym, "
+      "modoff, coverage or profile (can be repeated)");
+
+  const std::unordered_map<std::string, TraceFormat_t> TraceFormatMap = {
+      {"hex", TraceFormat_t::Hex},
+      {"raw64", TraceFormat_t::Raw64},
+      {"compact", TraceFormat_t::Compact},
+      {"tenet", TraceFormat_t::Tenet},
+      {"perf", TraceFormat_t::Perf}};
+
+  Symbolizer.add_option("--input-format", Opts.Format, "Input trace format")
+      ->transform(CLI::CheckedTransformer(TraceFormatMap, CLI::ignore_case))
+      ->default_val("hex");
   Symbolizer
       .add_flag("--overwrite", Opts.Overwrite,
                 "Overwrite the output file if necessary")
@@ -357,131 +546,403 @@ int main(int argc, char *argv[]) {
   Symbolizer
       .add_flag("--line-numbers", Opts.LineNumbers, "Include line numbers")
       ->default_val(false);
+  Symbolizer
+      .add_flag("--distinct", Opts.Distinct,
+                "Extract and resolve the distinct addresses first")
+      ->default_val(false);
+  Symbolizer
+      .add_option("--distinct-budget", Opts.DistinctBudget,
+                  "Memory budget (in MB) of the distinct address extraction")
+      ->default_val(1'024);
+  Symbolizer
+      .add_option("--spill-dir", Opts.SpillDir,
+                  "Spill directory of the distinct address extraction "
+                  "(default: temp directory)")
+      ->check(CLI::ExistingDirectory);
+  Symbolizer.add_option("--stats-json", Opts.StatsJsonPath,
+                        "Dump the run statistics as JSON into a file");
+  Symbolizer
+      .add_flag("--progress", Opts.Progress,
+                "Report the throughput and ETA on stderr every second")
+      ->default_val(false);
+  Symbolizer
+      .add_option("--cache-budget", Opts.CacheBudget,
+                  "Memory budget (in MB) of the address cache (default: "
+                  "unlimited)")
+      ->default_val(0);
+  Symbolizer
+      .add_option("--window-size", Opts.WindowSize,
+                  "Size (in MB) of the windows the traces are mapped with "
+                  "(default: 1024, 64 on 32-bit)")
+      ->default_val(0);
+  Symbolizer
+      .add_flag("--populate,!--no-populate", Opts.Populate,
+                "Fault the windows in when they get mapped")
+      ->default_val(true);
+  Symbolizer
+      .add_flag("--huge-pages", Opts.HugePages,
+                "Back the windows with transparent huge pages")
+      ->default_val(false);
+
+  const std::unordered_map<std::string, IoEngine_t> IoEngineMap = {
+      {"blocking", IoEngine_t::Blocking}, {"io_uring", IoEngine_t::IoUring}};
+
+  Symbolizer
+      .add_option("--io-engine", Opts.IoEngine,
+                  "I/O engine to read the traces and write the outputs with")
+      ->transform(CLI::CheckedTransformer(IoEngineMap, CLI::ignore_case))
+      ->default_val("blocking");
+  Symbolizer
+      .add_option("--jobs", Opts.Jobs,
+                  "Number of threads symbolizing chunks of a trace and "
+                  "writing them into the output file in parallel (default: "
+                  "single threaded)")
+      ->default_val(0);
+  Symbolizer
+      .add_option("--fold-loops", Opts.FoldLoops,
+                  "Fold the loops whose body is up to that many lines into "
+                  "their first iteration and a repeat count (default: off)")
+      ->default_val(0);
+  Symbolizer
+      .add_flag("--pack", Opts.Pack,
+                "Append the outputs to a single pack file at --output")
+      ->default_val(false);
+
+  const std::unordered_map<std::string, ScanMode_t> ScanModeMap = {
+      {"replace", ScanMode_t::Replace}, {"annotate", ScanMode_t::Annotate}};
+
+  Symbolizer
+      .add_option("--scan", Opts.Scan,
+                  "Symbolize the addresses found anywhere in the lines of "
+                  "text inputs (logs, stack dumps), replacing or annotating "
+                  "them")
+      ->transform(CLI::CheckedTransformer(ScanModeMap, CLI::ignore_case));
+  Symbolizer
+      .add_option("--column", Opts.Columns.Column,
+                  "Read the addresses from that column (from 1) of the lines "
+                  "of hex traces rather than from their start")
+      ->default_val(0);
+
+  std::string Delimiter;
+  Symbolizer.add_option("--delimiter", Delimiter,
+                        "Character separating the columns, \\t for a tab "
+                        "(default: runs of blanks)");
+  Symbolizer
+      .add_flag("--passthrough", Opts.Passthrough,
+                "Keep the other columns of the lines around the symbols")
+      ->default_val(false);
+  Symbolizer
+      .add_flag("--perf-counters", Opts.PerfCounters,
+                "Sample the hardware performance counters of every stage")
+      ->default_val(false);
 
   CLI11_PARSE(Symbolizer, argc, argv);
 
+  if (Opts.CrashdumpPath.empty() && Opts.SymbolMapPath.empty()) {
+    fmt::print("Either a crash-dump or a symbol map is required\n");
+    return EXIT_FAILURE;
+  }
+
   //
-  // Calculate a bunch of useful variables to take decisions later.
+  // Compile the output format; the line numbers are prepended to it the same
+  // way the built-in styles do. The JSON Lines style is an output format too,
+  // and its records always have the line number. The other columns can't go
+  // around its records, nor can the markers of the folded loops go between
+  // them, as they wouldn't be JSON anymore.
   //
 
-  const bool InputIsDirectory = fs::is_directory(Opts.Input);
-  const bool OutputIsDirectory = fs::is_directory(Opts.Output);
-  const bool OutputDoesntExist = !fs::exists(Opts.Output);
-  const bool OutputIsFile = fs::is_regular_file(Opts.Output);
-  const bool OutputIsStdout = Opts.Output.empty();
+  if (Opts.Style == TraceStyle_t::Jsonl) {
+    if (Opts.Passthrough) {
+      fmt::print("--passthrough can't be used with --style jsonl\n");
+      return EXIT_FAILURE;
+    }
+
+    if (Opts.FoldLoops > 0) {
+      fmt::print("--fold-loops can't be used with --style jsonl\n");
+      return EXIT_FAILURE;
+    }
+
+    OutputFormat = OutputFormat_t::Jsonl;
+  } else if (!OutputFormat.empty() && Opts.LineNumbers) {
+    OutputFormat.insert(0, "l{line}: ");
+  }
+
+  if (!OutputFormat.empty()) {
+    if (!Opts.OutputFormat.Compile(OutputFormat)) {
+      return EXIT_FAILURE;
+    }
+
+    Opts.Style = TraceStyle_t::Custom;
+  }
 
   //
-  // Initialize the debug engine APIs.
+  // Scanning text replaces the addresses in place, in the fullsym or modoff
+  // style. The lines are walked in order on a single thread and don't go
+  // through the options that only make sense for one address per line.
   //
 
-  DbgEng_t DbgEng;
-  if (!DbgEng.Init(Opts.CrashdumpPath)) {
-    fmt::print("Failed to initialize the debugger api\n");
+  if (Opts.Scan != ScanMode_t::Off) {
+    if (Opts.Style == TraceStyle_t::Custom ||
+        Opts.Format != TraceFormat_t::Hex) {
+      fmt::print("--scan needs text inputs and the fullsym or modoff style\n");
+      return EXIT_FAILURE;
+    }
+
+    if (Opts.Distinct || Opts.Jobs > 0 || Opts.FoldLoops > 0 ||
+        !SinkSpecs.empty()) {
+      fmt::print("--scan walks the lines in order on a single thread, "
+                 "ignoring --distinct, --jobs, --fold-loops and --sink\n");
+      Opts.Distinct = false;
+      Opts.Jobs = 0;
+      Opts.FoldLoops = 0;
+      SinkSpecs.clear();
+    }
+  }
+
+  //
+  // The columns are only a thing in hex traces. Passing the lines through
+  // without --column keeps everything after the address at their start.
+  //
+
+  if (Delimiter == "\\t") {
+    Delimiter = "\t";
+  }
+
+  if (Delimiter.size() > 1) {
+    fmt::print("--delimiter takes a single character\n");
+    return EXIT_FAILURE;
+  }
+
+  Opts.Columns.Delimiter = Delimiter.empty() ? 0 : Delimiter[0];
+  if (Opts.Passthrough && Opts.Columns.Column == 0) {
+    Opts.Columns.Column = 1;
+  }
+
+  if (Opts.Columns.Column > 0 &&
+      (Opts.Format != TraceFormat_t::Hex || Opts.Scan != ScanMode_t::Off)) {
+    fmt::print("--column and --passthrough need hex traces and can't be used "
+               "with --scan\n");
     return EXIT_FAILURE;
   }
 
   //
-  // If the input flag is a folder, then we enumerate the files inside it.
+  // Calculate a bunch of useful variables to take decisions later.
   //
 
-  std::vector<fs::path> Inputs;
-  if (InputIsDirectory) {
+  const bool InputIsDirectory = fs::is_directory(Opts.Input);
+  const bool InputIsArchive =
+      !InputIsDirectory && TarArchive_t::IsArchive(Opts.Input);
+  const bool OutputIsDirectory = fs::is_directory(Opts.Output);
+  const bool OutputIsStdout = Opts.Output.empty();
+
+  //
+  // If the input flag is a folder, then we enumerate the files inside it; if
+  // it is a tar archive, its members get symbolized in place.
+  //
+
+  std::vector<InputTrace_t> Inputs;
+  if (InputIsDirectory || InputIsArchive) {
     //
     // If the output is not a directory nor stdout, then it doesn't make any
     // sense, so bail.
     //
 
-    if (!OutputIsDirectory && !OutputIsStdout) {
+    if (!OutputIsDirectory && !OutputIsStdout && !Opts.Pack) {
       fmt::print("When the input is a directory, the output can only be either "
                  "empty (for stdout) or a directory as well\n");
     }
+  }
+
+  if (InputIsDirectory) {
+    Inputs = EnumerateDirectory(Opts.Input);
+  } else if (InputIsArchive) {
+    Archive.emplace();
+    if (!Archive->Open(Opts.Input)) {
+      return EXIT_FAILURE;
+    }
 
-    const fs::directory_iterator DirIt(Opts.Input);
-    for (const auto &DirEntry : DirIt) {
-      Inputs.emplace_back(DirEntry);
+    for (const auto &Member : Archive->Members()) {
+      Inputs.emplace_back(InputTrace_t{Member.Name, Member.Data.size()});
     }
   } else {
-    Inputs.emplace_back(Opts.Input);
+    std::error_code Ec;
+    const uint64_t Size = fs::file_size(Opts.Input, Ec);
+    Inputs.emplace_back(InputTrace_t{Opts.Input, Ec ? 0 : Size});
   }
 
   //
-  // Symbolize each files.
+  // Symbolize each files with either the debug engine APIs or the symbol map.
   //
 
-  fmt::print("Starting to process files..\n");
-  const auto Before = chrono::high_resolution_clock::now();
-  for (const auto &Input : Inputs) {
+#ifdef SYMBOLIZER_INSTRUMENTATION
+  Instrumentation_t::InstallSignalHandler();
+#endif
 
-    //
-    // If we run symbolizer from the same directory for both inputs and outputs,
-    // we are going to see '.symbolizer' files into the input directory, so
-    // let's just keep them instead of bailing.
-    //
+  //
+  // Fall back to blocking I/O if io_uring isn't available.
+  //
 
-    if (Input.filename().string().ends_with(".symbolizer")) {
-      fmt::print("Skipping %s..\n", Input.string().c_str());
-      continue;
-    }
+  if (Opts.IoEngine == IoEngine_t::IoUring && !IoRing_t::Supported()) {
+    fmt::print("io_uring is unavailable, falling back to blocking I/O\n");
+    Opts.IoEngine = IoEngine_t::Blocking;
+  }
 
-    //
-    // Calculate the output path.
-    //
+  //
+  // Attach the sinks. The lines are fanned out to them through the address
+  // cache on a single thread.
+  //
+
+  if (!SinkSpecs.empty()) {
+    const std::unordered_map<std::string, SinkKind_t> SinkKindMap = {
+        {"fullsym", SinkKind_t::FullSymbol},
+        {"modoff", SinkKind_t::Modoff},
+        {"coverage", SinkKind_t::Coverage},
+        {"profile", SinkKind_t::Profile}};
+
+    Sinks.emplace();
+    for (const auto &Spec : SinkSpecs) {
+      const size_t Equal = Spec.find('=');
+      const auto &KindIt = Equal == Spec.npos
+                               ? SinkKindMap.end()
+                               : SinkKindMap.find(Spec.substr(0, Equal));
+      if (KindIt == SinkKindMap.end()) {
+        fmt::print("The sink '{}' should be KIND=PATH with KIND in fullsym, "
+                   "modoff, coverage or profile\n",
+                   Spec);
+        return EXIT_FAILURE;
+      }
 
-    fs::path Output;
-    if (OutputIsDirectory) {
+      const fs::path Path = Spec.substr(Equal + 1);
+      if (fs::exists(Path) && !Opts.Overwrite) {
+        fmt::print("The sink file {} already exists\n", Path.string());
+        return EXIT_FAILURE;
+      }
 
-      //
-      // If the output is a directory then generate an output file path.
-      //
+      Sinks->Open(KindIt->second, Path);
+    }
 
-      Output =
-          Opts.Output / fmt::format("{}.symbolizer", Input.filename().string());
-    } else if (OutputDoesntExist || OutputIsFile) {
+    if (Opts.Distinct || Opts.Jobs > 0) {
+      fmt::print("--sink goes through the address cache on a single thread, "
+                 "ignoring --distinct and --jobs\n");
+      Opts.Distinct = false;
+      Opts.Jobs = 0;
+    }
 
-      //
-      // There are two cases to consider here:
-      //   - Either it is a path to a file that doesn't exist yet as we'll
-      //   create it,
-      //   - Or it points to an already existing file and the user might want to
-      //   overwrite it.
-      //
+    if (Opts.CacheBudget > 0) {
+      fmt::print("--sink keeps an entry for every distinct address of the "
+                 "run, which --cache-budget doesn't bound\n");
+    }
+  }
 
-      Output = Opts.Output;
-    } else {
+  //
+  // Create the pack the outputs get appended to.
+  //
 
-      //
-      // It is empty, data will be dumped on stdout.
-      //
+  if (Opts.Pack) {
+    if (OutputIsStdout || OutputIsDirectory) {
+      fmt::print("--pack needs an output file\n");
+      return EXIT_FAILURE;
     }
 
-    //
-    // Verify that we are not about to overwrite an already generated trace
-    // file. If the user specify specify --overwrite we will overwrite the files
-    // that already exist.
-    //
+    if (fs::exists(Opts.Output) && !Opts.Overwrite) {
+      fmt::print("The pack {} already exists\n", Opts.Output.string());
+      return EXIT_FAILURE;
+    }
 
-    if (!OutputIsStdout && fs::exists(Output)) {
-      if (!Opts.Overwrite) {
-        fmt::print("The output file {} already exists, continuing\n",
-                   Output.string());
-        continue;
-      }
+    Pack.emplace();
+    if (!Pack->Open(Opts.Output)) {
+      return EXIT_FAILURE;
+    }
+  }
 
-      fmt::print("The output file {} will be overwritten..\n", Output.string());
+  //
+  // Folding loops needs the lines in order.
+  //
+
+  if (Opts.FoldLoops > 0 && Opts.Jobs > 0) {
+    fmt::print("--fold-loops symbolizes on a single thread, ignoring --jobs\n");
+    Opts.Jobs = 0;
+  }
+
+  //
+  // A line of `perf script` can have several addresses, so its traces can't
+  // be cut in chunks at the record boundaries, and --skip / --max count
+  // addresses rather than lines.
+  //
+
+  if (Opts.Format == TraceFormat_t::Perf && Opts.Jobs > 0) {
+    fmt::print("--input-format perf walks the lines on a single thread, "
+               "ignoring --jobs\n");
+    Opts.Jobs = 0;
+  }
+
+  if (Opts.Format == TraceFormat_t::Perf &&
+      (SkipOption->count() > 0 || MaxOption->count() > 0)) {
+    fmt::print("--skip and --max count addresses with --input-format perf, "
+               "not lines\n");
+  }
+
+  //
+  // The members of an archive are symbolized straight from its mapping; the
+  // parallel mode walks trace files.
+  //
+
+  if (Archive && Opts.Jobs > 0) {
+    fmt::print("--jobs symbolizes trace files, ignoring it for the members "
+               "of {}\n",
+               Opts.Input.string());
+    Opts.Jobs = 0;
+  }
+
+  //
+  // The chunks are written at their offsets in the output file, which stdout
+  // doesn't have.
+  //
+
+  if (Opts.Jobs > 0 && OutputIsStdout) {
+    fmt::print("--jobs needs an output file, symbolizing on a single "
+               "thread\n");
+    Opts.Jobs = 0;
+  }
+
+  //
+  // Open the hardware performance counters if asked to; we carry on without
+  // them if they are not available.
+  //
+
+  if (Opts.PerfCounters) {
+    PerfCounters.emplace();
+    if (!PerfCounters->Init()) {
+      PerfCounters.reset();
     }
+  }
 
-    //
-    // Process the file.
-    //
+  fmt::print("Starting to process files..\n");
+  chrono::high_resolution_clock::time_point Before;
+  bool Symbolized = false;
+  if (!Opts.SymbolMapPath.empty()) {
+    SymbolMap_t SymbolMap;
+    if (!SymbolMap.Init(Opts.SymbolMapPath)) {
+      fmt::print("Failed to load the symbol map\n");
+      return EXIT_FAILURE;
+    }
 
-    if (!SymbolizeFile(DbgEng, Input, Output)) {
-      fmt::print("Parsing {} failed, exiting\n", Input.string());
-      break;
+    Before = chrono::high_resolution_clock::now();
+    Symbolized = SymbolizeFiles(SymbolMap, Inputs);
+  } else {
+#if defined(_WIN32)
+    DbgEng_t DbgEng;
+    if (!DbgEng.Init(Opts.CrashdumpPath)) {
+      fmt::print("Failed to initialize the debugger api\n");
+      return EXIT_FAILURE;
     }
 
-    Stats.NumberFiles++;
-    fmt::print("[{} / {}] {} done\r", Stats.NumberFiles, Inputs.size(),
-               Input.string());
+    Before = chrono::high_resolution_clock::now();
+    Symbolized = SymbolizeFiles(DbgEng, Inputs);
+#else
+    fmt::print("Crash-dumps can only be used on Windows, use a symbol map\n");
+    return EXIT_FAILURE;
+#endif
   }
 
   fmt::print("\n");
@@ -497,5 +958,39 @@ int main(int argc, char *argv[]) {
              SecondsToHuman(SecondsSince(Before)),
              NumberToHuman(Stats.NumberFiles));
 
-  return EXIT_SUCCESS;
+  if (Stats.NumberScannedLines > 0) {
+    fmt::print("Scanned {} lines.\n", NumberToHuman(Stats.NumberScannedLines));
+  }
+
+  if (Stats.NumberFoldedLines > 0) {
+    fmt::print("Folded {} lines of loops.\n",
+               NumberToHuman(Stats.NumberFoldedLines));
+  }
+
+  fmt::print("The address cache peaked at {:.1f}MB",
+             double(Stats.Memory.Cache) / (1'024 * 1'024));
+  if (Stats.CacheEvictions > 0) {
+    fmt::print(" and evicted {} symbols", NumberToHuman(Stats.CacheEvictions));
+  }
+
+  fmt::print(".\n");
+
+#ifdef SYMBOLIZER_INSTRUMENTATION
+  Instrumentation().Dump();
+#endif
+
+  if (PerfCounters) {
+    PerfCounters->Dump(Stats.NumberSymbolizedLines);
+  }
+
+  if (!Opts.StatsJsonPath.empty()) {
+    const auto &Elapsed = chrono::high_resolution_clock::now() - Before;
+    const uint64_t WallNs =
+        chrono::duration_cast<chrono::nanoseconds>(Elapsed).count();
+    if (!Stats.DumpJson(Opts.StatsJsonPath, WallNs)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return Symbolized ? EXIT_SUCCESS : EXIT_FAILURE;
 }
\ No newline at end of file
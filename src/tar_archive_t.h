@@ -0,0 +1,314 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "mapped_file_t.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//
+// A regular file stored in a tar archive; |Data| points into the mapping of
+// the archive.
+//
+
+struct TarMember_t {
+  std::string Name;
+  std::string_view Data;
+};
+
+//
+// This maps a tar archive once and walks its headers, so that its members can
+// be symbolized in place without being extracted first. An archive is a list
+// of 512 bytes headers, each followed by the data of the member padded to 512
+// bytes, and ends with zeroed blocks. The headers understood are the ones of
+// the original format, ustar (which splits long names in a prefix and a
+// name), GNU long names ('L') and pax extended headers ('x', for the long
+// names and the sizes that don't fit in the header).
+//
+
+class TarArchive_t {
+  static constexpr uint64_t BlockSize = 512;
+
+  MappedFile_t File_;
+  MappedView_t View_;
+  std::vector<TarMember_t> Members_;
+  std::unordered_map<std::string, size_t> Names_;
+
+  //
+  // Parse the number in the header field |Field|: octal digits padded with
+  // spaces or NULs, or a big-endian base-256 number if its first byte has the
+  // top bit set (GNU, for the sizes over 8GB).
+  //
+
+  static bool ParseNumber(const std::string_view Field, uint64_t &Number) {
+    Number = 0;
+    if (!Field.empty() && (uint8_t(Field[0]) & 0x80) != 0) {
+      for (size_t Idx = 0; Idx < Field.size(); Idx++) {
+        const uint8_t Byte = uint8_t(Field[Idx]) & (Idx == 0 ? 0x7f : 0xff);
+        if ((Number >> 56) != 0) {
+          return false;
+        }
+
+        Number = (Number << 8) | Byte;
+      }
+
+      return true;
+    }
+
+    size_t Idx = 0;
+    while (Idx < Field.size() && Field[Idx] == ' ') {
+      Idx++;
+    }
+
+    for (; Idx < Field.size() && Field[Idx] >= '0' && Field[Idx] <= '7';
+         Idx++) {
+      if ((Number >> 61) != 0) {
+        return false;
+      }
+
+      Number = (Number << 3) | (Field[Idx] - '0');
+    }
+
+    return Idx == Field.size() || Field[Idx] == ' ' || Field[Idx] == '\0';
+  }
+
+  //
+  // Returns the NUL terminated string in the header field |Field|.
+  //
+
+  static std::string_view ParseString(const std::string_view Field) {
+    return Field.substr(0, std::min(Field.find('\0'), Field.size()));
+  }
+
+  //
+  // Is |Header| a valid header? Its checksum is the sum of its bytes, with
+  // the checksum field counted as spaces.
+  //
+
+  static bool IsHeader(const char *Header) {
+    uint64_t Checksum = 0;
+    if (!ParseNumber(std::string_view(Header + 148, 8), Checksum)) {
+      return false;
+    }
+
+    uint64_t Sum = 8 * ' ';
+    for (uint64_t Idx = 0; Idx < BlockSize; Idx++) {
+      if (Idx < 148 || Idx >= 156) {
+        Sum += uint8_t(Header[Idx]);
+      }
+    }
+
+    return Sum == Checksum;
+  }
+
+  //
+  // Parse the records of the pax extended header |Data| ("<size> key=value\n"
+  // records) and pick up the path and the size of the next member.
+  //
+
+  static bool ParsePax(std::string_view Data, std::string &Path,
+                       uint64_t &Size, bool &HasSize) {
+    while (!Data.empty() && Data[0] != '\0') {
+      const size_t Space = Data.find(' ');
+      uint64_t Length = 0;
+      for (size_t Idx = 0; Idx < Space && Idx < Data.size(); Idx++) {
+        if (Data[Idx] < '0' || Data[Idx] > '9') {
+          return false;
+        }
+
+        Length = (Length * 10) + (Data[Idx] - '0');
+      }
+
+      if (Space == Data.npos || Length <= Space + 1 || Length > Data.size() ||
+          Data[Length - 1] != '\n') {
+        return false;
+      }
+
+      const std::string_view Record =
+          Data.substr(Space + 1, Length - Space - 2);
+      const size_t Equal = Record.find('=');
+      if (Equal != Record.npos) {
+        const std::string_view Key = Record.substr(0, Equal);
+        const std::string_view Value = Record.substr(Equal + 1);
+        if (Key == "path") {
+          Path = Value;
+        } else if (Key == "size") {
+          Size = 0;
+          for (const char C : Value) {
+            if (C < '0' || C > '9') {
+              return false;
+            }
+
+            Size = (Size * 10) + (C - '0');
+          }
+
+          HasSize = true;
+        }
+      }
+
+      Data.remove_prefix(Length);
+    }
+
+    return true;
+  }
+
+public:
+  TarArchive_t() = default;
+  ~TarArchive_t() { File_.Unmap(View_); }
+
+  //
+  // Rule of three.
+  //
+
+  TarArchive_t(const TarArchive_t &) = delete;
+  TarArchive_t &operator=(TarArchive_t &) = delete;
+
+  //
+  // Is the file at |Path| a tar archive? Only its first header is read.
+  //
+
+  static bool IsArchive(const fs::path &Path) {
+    FILE *File = fopen(Path.string().c_str(), "rb");
+    if (File == nullptr) {
+      return false;
+    }
+
+    char Header[BlockSize];
+    const bool Read = fread(Header, 1, sizeof(Header), File) == sizeof(Header);
+    fclose(File);
+    return Read && IsHeader(Header);
+  }
+
+  //
+  // Map the archive at |Path| and index its regular members. When a member
+  // appears more than once, the last one wins as it would when extracting.
+  //
+
+  bool Open(const fs::path &Path) {
+
+    //
+    // The members are walked front to back, and faulted in as they get
+    // symbolized rather than all up front.
+    //
+
+    MapHints_t Hints;
+    Hints.Populate = false;
+    Hints.DropBehind = false;
+    if (!File_.Open(Path, Hints)) {
+      return false;
+    }
+
+    const uint64_t Size = File_.Size();
+    if (Size < BlockSize || !File_.Map(0, Size, View_)) {
+      fmt::print("Could not map the archive {}\n", Path.string());
+      return false;
+    }
+
+    std::string LongName;
+    uint64_t LongSize = 0;
+    bool HasLongSize = false;
+    for (uint64_t Offset = 0; Offset + BlockSize <= Size;) {
+      const char *Header = View_.Base + Offset;
+      if (Header[0] == '\0') {
+        break;
+      }
+
+      uint64_t MemberSize = 0;
+      if (!IsHeader(Header) ||
+          !ParseNumber(std::string_view(Header + 124, 12), MemberSize)) {
+        fmt::print("The archive {} is corrupted at offset {:#x}\n",
+                   Path.string(), Offset);
+        return false;
+      }
+
+      const char Type = Header[156];
+      if (HasLongSize && Type != 'L' && Type != 'x') {
+        MemberSize = LongSize;
+      }
+
+      const uint64_t DataOffset = Offset + BlockSize;
+      if (MemberSize > Size - DataOffset) {
+        fmt::print("The archive {} is truncated\n", Path.string());
+        return false;
+      }
+
+      const std::string_view Data(View_.Base + DataOffset, MemberSize);
+      Offset = DataOffset + ((MemberSize + BlockSize - 1) & ~(BlockSize - 1));
+
+      //
+      // The long name and size headers describe the member that follows
+      // them.
+      //
+
+      if (Type == 'L') {
+        LongName = ParseString(Data);
+        continue;
+      }
+
+      if (Type == 'x') {
+        if (!ParsePax(Data, LongName, LongSize, HasLongSize)) {
+          fmt::print("The archive {} has a corrupted pax header\n",
+                     Path.string());
+          return false;
+        }
+
+        continue;
+      }
+
+      std::string Name = std::move(LongName);
+      LongName.clear();
+      HasLongSize = false;
+
+      //
+      // Skip everything but the regular files: directories, links, devices
+      // and global pax headers.
+      //
+
+      if (Type != '0' && Type != '\0' && Type != '7') {
+        continue;
+      }
+
+      if (Name.empty()) {
+        const std::string_view Prefix =
+            memcmp(Header + 257, "ustar", 5) == 0
+                ? ParseString(std::string_view(Header + 345, 155))
+                : std::string_view();
+        if (!Prefix.empty()) {
+          Name.assign(Prefix);
+          Name += '/';
+        }
+
+        Name += ParseString(std::string_view(Header, 100));
+      }
+
+      const auto &[It, Inserted] = Names_.try_emplace(Name, Members_.size());
+      if (!Inserted) {
+        Members_[It->second].Data = Data;
+        continue;
+      }
+
+      Members_.emplace_back(TarMember_t{std::move(Name), Data});
+    }
+
+    return true;
+  }
+
+  const std::vector<TarMember_t> &Members() const { return Members_; }
+
+  //
+  // Returns the member named |Name| if there is one.
+  //
+
+  const TarMember_t *Find(const std::string &Name) const {
+    const auto &It = Names_.find(Name);
+    return It == Names_.end() ? nullptr : &Members_[It->second];
+  }
+};
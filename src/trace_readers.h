@@ -0,0 +1,648 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/format.h>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//
+// The trace formats supported:
+//   - Hex: one hexadecimal address per line,
+//   - Raw64: an array of little-endian 64-bit addresses,
+//   - Compact: every address is encoded as the zigzag'd difference with the
+//   previous one (the first one is relative to zero) in LEB128. As traces are
+//   mostly sequential, most addresses fit in a single byte,
+//   - Tenet: one line per instruction with the registers it changed, like
+//   `rax=0x1,rip=0x7ff6a0c01000,mr=0x1000:41`. A line without a rip (or eip)
+//   delta is an instruction at the same address as the one before,
+//   - Perf: the output of `perf script`, with the ip of the samples and the
+//   from and to addresses of the branches.
+//
+
+enum class TraceFormat_t { Hex, Raw64, Compact, Tenet, Perf };
+
+//
+// The readers below walk a trace in [|Begin|, |End|) one record at a time.
+// |Next| returns false once there is no more complete record; otherwise it
+// returns the address as well as the text of the record for error messages
+// (which is empty for binary formats). A record cut by |End| is left alone so
+// that the reader can be rebased on a range that holds the whole record with
+// |Rebase|. |Position| returns where the next record starts and |Offset| its
+// distance from the beginning of the range.
+//
+
+class HexReader_t {
+  const char *Begin_;
+  const char *Current_;
+  const char *End_;
+
+  static bool IsBlank(const char C) {
+    return C == ' ' || C == '\t' || C == '\r';
+  }
+
+public:
+  explicit HexReader_t(const char *Begin, const char *End)
+      : Begin_(Begin), Current_(Begin), End_(End) {}
+
+  //
+  // Parse the hexadecimal number at the start of |Field| like strtoull does:
+  // the blanks before it and a 0x prefix are skipped. Unlike strtoull, this
+  // never reads past the field.
+  //
+
+  static uint64_t ParseAddress(const std::string_view Field) {
+    const char *Current = Field.data();
+    const char *End = Current + Field.size();
+    while (Current < End && IsBlank(*Current)) {
+      Current++;
+    }
+
+    if ((End - Current) > 2 && Current[0] == '0' &&
+        (Current[1] == 'x' || Current[1] == 'X')) {
+      Current += 2;
+    }
+
+    uint64_t Address = 0;
+    for (; Current < End; Current++) {
+      const char C = *Current;
+      uint64_t Digit = 0;
+      if (C >= '0' && C <= '9') {
+        Digit = C - '0';
+      } else if ((C | 0x20) >= 'a' && (C | 0x20) <= 'f') {
+        Digit = (C | 0x20) - 'a' + 10;
+      } else {
+        break;
+      }
+
+      Address = (Address << 4) | Digit;
+    }
+
+    return Address;
+  }
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    const char *LineFeed =
+        (const char *)memchr(Current_, '\n', End_ - Current_);
+    if (LineFeed == nullptr) {
+      return false;
+    }
+
+    Line = std::string_view(Current_, LineFeed);
+    Address = ParseAddress(Line);
+    Current_ = LineFeed + 1;
+    return true;
+  }
+
+  void Rebase(const char *Begin, const char *End) {
+    Begin_ = Current_ = Begin;
+    End_ = End;
+  }
+
+  const char *Position() const { return Current_; }
+  uint64_t Offset() const { return Current_ - Begin_; }
+};
+
+//
+// Where the address is in the lines of a trace with several columns (like
+// `tid rip` or `rip cr3 tsc`): in the |Column|th field, counting from one.
+// The fields are separated by |Delimiter|, or by runs of blanks if it is
+// zero.
+//
+
+struct ColumnSpec_t {
+  uint32_t Column = 0;
+  char Delimiter = 0;
+};
+
+//
+// This reads the address of every line of a hex trace from one of its
+// columns; |Select| sets which one. |Line| is still the whole line, so that
+// the other columns can go through around the symbol.
+//
+
+class ColumnReader_t {
+  const char *Begin_;
+  const char *Current_;
+  const char *End_;
+  ColumnSpec_t Spec_;
+
+  static bool IsBlank(const char C) {
+    return C == ' ' || C == '\t' || C == '\r';
+  }
+
+public:
+  explicit ColumnReader_t(const char *Begin, const char *End)
+      : Begin_(Begin), Current_(Begin), End_(End) {}
+
+  void Select(const ColumnSpec_t &Spec) { Spec_ = Spec; }
+
+  //
+  // Returns the field of |Line| selected by |Spec|; it is empty (and at the
+  // end of the line) if the line has fewer fields than that.
+  //
+
+  static std::string_view Field(const std::string_view Line,
+                                const ColumnSpec_t &Spec) {
+    const char *Current = Line.data();
+    const char *End = Current + Line.size();
+    if (Spec.Delimiter != 0) {
+      for (uint32_t Idx = 1; Idx < Spec.Column; Idx++) {
+        const char *Delimiter =
+            (const char *)memchr(Current, Spec.Delimiter, End - Current);
+        if (Delimiter == nullptr) {
+          return std::string_view(End, 0);
+        }
+
+        Current = Delimiter + 1;
+      }
+
+      const char *Delimiter =
+          (const char *)memchr(Current, Spec.Delimiter, End - Current);
+      return std::string_view(Current, Delimiter == nullptr ? End : Delimiter);
+    }
+
+    for (uint32_t Idx = 1;; Idx++) {
+      while (Current < End && IsBlank(*Current)) {
+        Current++;
+      }
+
+      const char *FieldEnd = Current;
+      while (FieldEnd < End && !IsBlank(*FieldEnd)) {
+        FieldEnd++;
+      }
+
+      if (Idx == Spec.Column || Current == End) {
+        return std::string_view(Current, FieldEnd);
+      }
+
+      Current = FieldEnd;
+    }
+  }
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    const char *LineFeed =
+        (const char *)memchr(Current_, '\n', End_ - Current_);
+    if (LineFeed == nullptr) {
+      return false;
+    }
+
+    Line = std::string_view(Current_, LineFeed);
+    Address = HexReader_t::ParseAddress(Field(Line, Spec_));
+    Current_ = LineFeed + 1;
+    return true;
+  }
+
+  void Rebase(const char *Begin, const char *End) {
+    Begin_ = Current_ = Begin;
+    End_ = End;
+  }
+
+  const char *Position() const { return Current_; }
+  uint64_t Offset() const { return Current_ - Begin_; }
+};
+
+//
+// This walks the lines of a text, for --scan; there is no address to parse.
+//
+
+class LineReader_t {
+  const char *Begin_;
+  const char *Current_;
+  const char *End_;
+
+public:
+  explicit LineReader_t(const char *Begin, const char *End)
+      : Begin_(Begin), Current_(Begin), End_(End) {}
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    const char *LineFeed =
+        (const char *)memchr(Current_, '\n', End_ - Current_);
+    if (LineFeed == nullptr) {
+      return false;
+    }
+
+    Address = 0;
+    Line = std::string_view(Current_, LineFeed);
+    Current_ = LineFeed + 1;
+    return true;
+  }
+
+  void Rebase(const char *Begin, const char *End) {
+    Begin_ = Current_ = Begin;
+    End_ = End;
+  }
+
+  const char *Position() const { return Current_; }
+  uint64_t Offset() const { return Current_ - Begin_; }
+};
+
+class Raw64Reader_t {
+  const char *Begin_;
+  const char *Current_;
+  const char *End_;
+
+public:
+  explicit Raw64Reader_t(const char *Begin, const char *End)
+      : Begin_(Begin), Current_(Begin), End_(End) {}
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    if (size_t(End_ - Current_) < sizeof(Address)) {
+      return false;
+    }
+
+    memcpy(&Address, Current_, sizeof(Address));
+    Line = {};
+    Current_ += sizeof(Address);
+    return true;
+  }
+
+  void Rebase(const char *Begin, const char *End) {
+    Begin_ = Current_ = Begin;
+    End_ = End;
+  }
+
+  const char *Position() const { return Current_; }
+  uint64_t Offset() const { return Current_ - Begin_; }
+};
+
+class CompactReader_t {
+  const uint8_t *Begin_;
+  const uint8_t *Current_;
+  const uint8_t *End_;
+  uint64_t Previous_ = 0;
+
+public:
+  explicit CompactReader_t(const char *Begin, const char *End)
+      : Begin_((const uint8_t *)Begin), Current_((const uint8_t *)Begin),
+        End_((const uint8_t *)End) {}
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    const uint8_t *Start = Current_;
+    uint64_t ZigZag = 0;
+    for (uint32_t Shift = 0; Shift < 64; Shift += 7) {
+      if (Current_ == End_) {
+        Current_ = Start;
+        return false;
+      }
+
+      const uint8_t Byte = *Current_++;
+      ZigZag |= uint64_t(Byte & 0x7f) << Shift;
+      if ((Byte & 0x80) == 0) {
+        const uint64_t Delta = (ZigZag >> 1) ^ (~(ZigZag & 1) + 1);
+        Address = Previous_ + Delta;
+        Previous_ = Address;
+        Line = {};
+        return true;
+      }
+    }
+
+    //
+    // The encoding is malformed; stop there.
+    //
+
+    Current_ = End_;
+    return false;
+  }
+
+  //
+  // Start from the middle of a trace; |Previous| is the address of the record
+  // before the one the reader is at.
+  //
+
+  void Resume(const uint64_t Previous) { Previous_ = Previous; }
+
+  //
+  // The previous address is kept as the next record is relative to it.
+  //
+
+  void Rebase(const char *Begin, const char *End) {
+    Begin_ = Current_ = (const uint8_t *)Begin;
+    End_ = (const uint8_t *)End;
+  }
+
+  const char *Position() const { return (const char *)Current_; }
+  uint64_t Offset() const { return Current_ - Begin_; }
+};
+
+//
+// This reads the rip of every line of a Tenet trace. The register names with
+// an 'i' are few (rip, rsi, rdi, sil, dil and their 32-bit versions) and the
+// values are hexadecimal, so the key is found by jumping from 'i' to 'i' with
+// memchr rather than by splitting the line in fields.
+//
+
+class TenetReader_t {
+  const char *Begin_;
+  const char *Current_;
+  const char *End_;
+  uint64_t Previous_ = 0;
+
+public:
+  explicit TenetReader_t(const char *Begin, const char *End)
+      : Begin_(Begin), Current_(Begin), End_(End) {}
+
+  //
+  // Returns where the value of the rip (or eip) of the line in [|Begin|,
+  // |End|) starts, or nullptr if it has no such delta.
+  //
+
+  static const char *FindPc(const char *Begin, const char *End) {
+    const char *Current = Begin;
+    while ((End - Current) >= 3) {
+      const char *I = (const char *)memchr(Current + 1, 'i', End - Current - 3);
+      if (I == nullptr) {
+        return nullptr;
+      }
+
+      if ((I[-1] == 'r' || I[-1] == 'e') && I[1] == 'p' && I[2] == '=' &&
+          (I - 1 == Begin || I[-2] == ',')) {
+        return I + 3;
+      }
+
+      Current = I;
+    }
+
+    return nullptr;
+  }
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    const char *LineFeed =
+        (const char *)memchr(Current_, '\n', End_ - Current_);
+    if (LineFeed == nullptr) {
+      return false;
+    }
+
+    const char *Pc = FindPc(Current_, LineFeed);
+    if (Pc != nullptr) {
+      Previous_ = HexReader_t::ParseAddress(std::string_view(Pc, LineFeed));
+    }
+
+    Address = Previous_;
+    Line = std::string_view(Current_, LineFeed);
+    Current_ = LineFeed + 1;
+    return true;
+  }
+
+  //
+  // Start from the middle of a trace; |Previous| is the address of the line
+  // before the one the reader is at.
+  //
+
+  void Resume(const uint64_t Previous) { Previous_ = Previous; }
+
+  //
+  // The previous address is kept as the next line might not have a rip.
+  //
+
+  void Rebase(const char *Begin, const char *End) {
+    Begin_ = Current_ = Begin;
+    End_ = End;
+  }
+
+  const char *Position() const { return Current_; }
+  uint64_t Offset() const { return Current_ - Begin_; }
+};
+
+//
+// This reads the addresses out of the output of `perf script`:
+//   - The ip of the samples, which follows the event name (`cycles:u:`), as
+//   well as the one of every frame of their callchain with -g (the lines
+//   that start with the ip),
+//   - The from and to addresses of the branches (--itrace=b), which are on
+//   both sides of `=>`,
+//   - The from and to addresses of every entry of the branch stacks
+//   (-F brstack), which look like `0x401020/0x401100/P/-/-/0`.
+// A line can have several addresses, or none (the `#` lines of --header,
+// blank lines); they are handed out one at a time along with the line they
+// come from, so records aren't lines anymore and |LineNumber| tells which
+// line the last one comes from.
+//
+
+class PerfReader_t {
+  const char *Begin_;
+  const char *Current_;
+  const char *End_;
+
+  //
+  // The addresses of the line being handed out, and the next one to hand
+  // out.
+  //
+
+  std::vector<uint64_t> Addresses_;
+  size_t Next_ = 0;
+  std::string_view Line_;
+
+  //
+  // The number of lines read, and the one of the line being handed out.
+  //
+
+  uint64_t Lines_ = 0;
+  uint64_t LineNumber_ = 0;
+
+  static bool IsBlank(const char C) {
+    return C == ' ' || C == '\t' || C == '\r';
+  }
+
+  //
+  // Parse |Token| if it is a hexadecimal number and nothing else; the 0x
+  // prefix is optional.
+  //
+
+  static bool ParseHex(std::string_view Token, uint64_t &Address) {
+    if (Token.size() > 2 && Token[0] == '0' && Token[1] == 'x') {
+      Token.remove_prefix(2);
+    }
+
+    if (Token.empty() || Token.size() > 16) {
+      return false;
+    }
+
+    Address = 0;
+    for (const char C : Token) {
+      uint64_t Digit = 0;
+      if (C >= '0' && C <= '9') {
+        Digit = C - '0';
+      } else if ((C | 0x20) >= 'a' && (C | 0x20) <= 'f') {
+        Digit = (C | 0x20) - 'a' + 10;
+      } else {
+        return false;
+      }
+
+      Address = (Address << 4) | Digit;
+    }
+
+    return true;
+  }
+
+  //
+  // Walk the blank separated tokens of |Line|, from |Current|.
+  //
+
+  static std::string_view NextToken(const std::string_view Line,
+                                    const char *&Current) {
+    const char *End = Line.data() + Line.size();
+    while (Current < End && IsBlank(*Current)) {
+      Current++;
+    }
+
+    const char *Token = Current;
+    while (Current < End && !IsBlank(*Current)) {
+      Current++;
+    }
+
+    return std::string_view(Token, Current);
+  }
+
+public:
+  explicit PerfReader_t(const char *Begin, const char *End)
+      : Begin_(Begin), Current_(Begin), End_(End) {}
+
+  //
+  // Collect the addresses of |Line| into |Addresses|.
+  //
+
+  static void ParseLine(const std::string_view Line,
+                        std::vector<uint64_t> &Addresses) {
+    Addresses.clear();
+
+    //
+    // Skip the blank lines and the comments (`perf script --header`).
+    //
+
+    const size_t Start = Line.find_first_not_of(" \t");
+    if (Start == Line.npos || Line[Start] == '#') {
+      return;
+    }
+
+    //
+    // The addresses come after the header of the sample (comm, tid, time,
+    // event, etc.) which ends with the last field ending with a colon before
+    // the branch arrow, if any. The lines of the callchains don't have one.
+    // The colons are few (the symbols of the branches have some), so they
+    // are jumped to with memchr.
+    //
+
+    const char *Current = Line.data();
+    const char *End = Current + Line.size();
+    const size_t Arrow = Line.find("=>");
+    const char *HeaderEnd = Arrow == Line.npos ? End : Current + Arrow;
+    const char *Fields = Current;
+    for (const char *Colon = Current;
+         (Colon = (const char *)memchr(Colon, ':', HeaderEnd - Colon)) !=
+         nullptr;
+         Colon++) {
+      if (Colon + 1 == End || IsBlank(Colon[1])) {
+        Fields = Colon + 1;
+      }
+    }
+
+    Current = Fields;
+    bool First = true;
+    bool Target = false;
+    uint64_t Address = 0;
+    for (std::string_view Token = NextToken(Line, Current); !Token.empty();
+         Token = NextToken(Line, Current)) {
+      if (Token == "=>") {
+        Target = true;
+        continue;
+      }
+
+      if (First || Target) {
+        First = Target = false;
+        if (ParseHex(Token, Address)) {
+          Addresses.emplace_back(Address);
+          continue;
+        }
+      }
+
+      //
+      // A branch stack entry starts with its from and to addresses.
+      //
+
+      const size_t From = Token.find('/');
+      if (From == Token.npos || !Token.starts_with("0x")) {
+        continue;
+      }
+
+      const size_t To = Token.find('/', From + 1);
+      uint64_t ToAddress = 0;
+      if (To != Token.npos && ParseHex(Token.substr(0, From), Address) &&
+          ParseHex(Token.substr(From + 1, To - From - 1), ToAddress)) {
+        Addresses.emplace_back(Address);
+        Addresses.emplace_back(ToAddress);
+      }
+    }
+  }
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    while (Next_ == Addresses_.size()) {
+      const char *LineFeed =
+          (const char *)memchr(Current_, '\n', End_ - Current_);
+      if (LineFeed == nullptr) {
+        return false;
+      }
+
+      Line_ = std::string_view(Current_, LineFeed);
+      Current_ = LineFeed + 1;
+      LineNumber_ = Lines_++;
+      ParseLine(Line_, Addresses_);
+      Next_ = 0;
+    }
+
+    Address = Addresses_[Next_++];
+    Line = Line_;
+    return true;
+  }
+
+  uint64_t LineNumber() const { return LineNumber_; }
+
+  void Rebase(const char *Begin, const char *End) {
+    Begin_ = Current_ = Begin;
+    End_ = End;
+  }
+
+  const char *Position() const { return Current_; }
+  uint64_t Offset() const { return Current_ - Begin_; }
+};
+
+//
+// Append |Address| to |Trace| in the compact format; |Previous| is the
+// previously encoded address.
+//
+
+template <typename Buffer_t>
+void AppendCompact(Buffer_t &Trace, const uint64_t Previous,
+                   const uint64_t Address) {
+  const int64_t Delta = int64_t(Address - Previous);
+  uint64_t ZigZag = (uint64_t(Delta) << 1) ^ uint64_t(Delta >> 63);
+  while (ZigZag >= 0x80) {
+    Trace.push_back(char(uint8_t(ZigZag) | 0x80));
+    ZigZag >>= 7;
+  }
+
+  Trace.push_back(char(ZigZag));
+}
+
+//
+// Append the line of an instruction at |Address| to |Trace| in the Tenet
+// format; |Previous| is the address of the instruction before. There are no
+// registers to report in a synthetic trace, so every line has a made up rax
+// delta, followed by the rip delta unless the instruction repeats (like a
+// rep prefixed one).
+//
+
+template <typename Buffer_t>
+void AppendTenet(Buffer_t &Trace, const uint64_t Previous,
+                 const uint64_t Address) {
+  if (Address == Previous) {
+    fmt::format_to(std::back_inserter(Trace), "rax={:#x}\n", Address >> 12);
+    return;
+  }
+
+  fmt::format_to(std::back_inserter(Trace), "rax={:#x},rip={:#x}\n",
+                 Address >> 12, Address);
+}
@@ -0,0 +1,248 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include "mapped_file_t.h"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+//
+// This maps a trace file one window at a time, which allows to walk traces
+// that are larger than the address space (32-bit builds) or than the memory
+// available. A window always starts at an offset aligned on the mapping
+// granularity, so the window that follows another one starts at the aligned
+// offset of the first record that didn't fit in it: windows overlap and the
+// record that straddles a boundary is read whole from the next window.
+//
+// The windows a batch of records went through stay mapped until the batch has
+// been processed, as its records point into them. Once a part of the file
+// isn't mapped anymore, its pages are dropped from the page cache so that
+// walking a huge trace doesn't evict everything else.
+//
+
+class TraceWindows_t {
+  MappedFile_t File_;
+
+  //
+  // The size of a window.
+  //
+
+  uint64_t WindowSize_ = 0;
+
+  //
+  // The window being walked, the ones walked before it that are still in use
+  // and how much of the file has been dropped from the page cache.
+  //
+
+  MappedView_t Current_;
+  std::vector<MappedView_t> Retired_;
+  uint64_t Released_ = 0;
+  bool DropBehind_ = true;
+
+public:
+  //
+  // The default window size; smaller on 32-bit builds as the address space
+  // is scarce there.
+  //
+
+  static constexpr uint64_t DefaultWindowSize =
+      sizeof(void *) == 4 ? 64 * 1'024 * 1'024 : 1'024 * 1'024 * 1'024;
+
+  TraceWindows_t() = default;
+  ~TraceWindows_t() {
+    Release();
+    File_.Unmap(Current_);
+  }
+
+  //
+  // Rule of three.
+  //
+
+  TraceWindows_t(const TraceWindows_t &) = delete;
+  TraceWindows_t &operator=(TraceWindows_t &) = delete;
+
+  //
+  // Open the trace at |Path|, it will be mapped |WindowSize| bytes at a time
+  // (rounded up to the mapping granularity) according to |Hints|.
+  //
+
+  bool Open(const fs::path &Path, const uint64_t WindowSize,
+            const MapHints_t &Hints = {}) {
+    if (!File_.Open(Path, Hints)) {
+      return false;
+    }
+
+    DropBehind_ = Hints.DropBehind;
+    //
+    // A window needs to be at least two granules large for the windows to
+    // move forward.
+    //
+
+    const uint64_t Granularity = File_.Granularity();
+    WindowSize_ = std::max(WindowSize, 2 * Granularity);
+    WindowSize_ = (WindowSize_ + Granularity - 1) & ~(Granularity - 1);
+    return true;
+  }
+
+  uint64_t Size() const { return File_.Size(); }
+
+  //
+  // Returns the offset in the file of |Position|, which points into the
+  // current window.
+  //
+
+  uint64_t OffsetOf(const char *Position) const {
+    return Current_.Offset + (Position - Current_.Base);
+  }
+
+  //
+  // Returns the offset in the file where the current window ends.
+  //
+
+  uint64_t WindowEnd() const { return Current_.Offset + Current_.Size; }
+
+  //
+  // Map the window that starts at the aligned offset of |Offset|. |Begin|
+  // and |End| are set to the part of the file from |Offset| to the end of the
+  // window.
+  //
+
+  bool Map(const uint64_t Offset, const char *&Begin, const char *&End) {
+    const uint64_t Start = Offset - (Offset % File_.Granularity());
+    const uint64_t Size = std::min(WindowSize_, File_.Size() - Start);
+    if (Current_.Base == nullptr || Current_.Offset != Start) {
+      if (Current_.Base != nullptr) {
+        Retired_.push_back(Current_);
+        Current_ = {};
+      }
+
+      if (Size > 0) {
+        if (!File_.Map(Start, Size, Current_)) {
+          return false;
+        }
+
+        //
+        // Get the next window read while this one is being walked.
+        //
+
+        File_.ReadAhead(Start + Size, WindowSize_);
+      }
+    }
+
+    Begin = Current_.Base + (Offset - Start);
+    End = Current_.Base + Current_.Size;
+    return true;
+  }
+
+  //
+  // Unmap the windows walked before the current one; nothing points into them
+  // anymore.
+  //
+
+  void Release() {
+    for (MappedView_t &View : Retired_) {
+      File_.Unmap(View);
+    }
+
+    Retired_.clear();
+    if (!DropBehind_) {
+      return;
+    }
+
+    //
+    // Drop the pages that aren't mapped anymore from the page cache.
+    //
+
+    const uint64_t Offset =
+        Current_.Base != nullptr ? Current_.Offset : File_.Size();
+    if (Offset > Released_) {
+      File_.DropPages(Released_, Offset - Released_);
+      Released_ = Offset;
+    }
+  }
+};
+
+//
+// This walks the records of a trace window by window with a |Reader_t|. When
+// the reader runs out of complete records, the next window is mapped from the
+// record it stopped at and the reader is rebased on it. The records handed out
+// stay valid until |Release| is called.
+//
+
+template <typename Reader_t> class WindowedReader_t {
+  TraceWindows_t &Windows_;
+  Reader_t Reader_;
+
+public:
+  explicit WindowedReader_t(TraceWindows_t &Windows, const char *Begin,
+                            const char *End)
+      : Windows_(Windows), Reader_(Begin, End) {}
+
+  bool Next(uint64_t &Address, std::string_view &Line) {
+    while (!Reader_.Next(Address, Line)) {
+      const uint64_t WindowEnd = Windows_.WindowEnd();
+      if (WindowEnd >= Windows_.Size()) {
+        return false;
+      }
+
+      const char *Begin = nullptr;
+      const char *End = nullptr;
+      if (!Windows_.Map(Windows_.OffsetOf(Reader_.Position()), Begin, End)) {
+        return false;
+      }
+
+      //
+      // If the new window doesn't go further than the previous one, the
+      // record is larger than a window and we can't go on.
+      //
+
+      if (Windows_.WindowEnd() <= WindowEnd) {
+        fmt::print("A record at {:#x} is larger than the window size\n",
+                   Windows_.OffsetOf(Begin));
+        return false;
+      }
+
+      Reader_.Rebase(Begin, End);
+    }
+
+    return true;
+  }
+
+  //
+  // Resume the walk of a delta encoded trace from the middle of it; |Previous|
+  // is the address of the record before the first one.
+  //
+
+  void Resume(const uint64_t Previous) {
+    if constexpr (requires { Reader_.Resume(Previous); }) {
+      Reader_.Resume(Previous);
+    }
+  }
+
+  //
+  // Select the column the addresses are read from, for the readers of traces
+  // with several columns.
+  //
+
+  template <typename Spec_t> void Select(const Spec_t &Spec) {
+    Reader_.Select(Spec);
+  }
+
+  //
+  // The line of the last record, for the readers whose records aren't lines.
+  //
+
+  uint64_t LineNumber() const
+    requires requires(const Reader_t &Reader) { Reader.LineNumber(); }
+  {
+    return Reader_.LineNumber();
+  }
+
+  void Release() { Windows_.Release(); }
+  const char *Position() const { return Reader_.Position(); }
+  uint64_t Offset() const { return Windows_.OffsetOf(Reader_.Position()); }
+};
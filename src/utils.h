@@ -0,0 +1,255 @@
+// Axel '0vercl0k' Souchet - October 18 2026
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <fmt/format.h>
+#include <new>
+#include <string>
+#include <string_view>
+
+#if defined(_WIN32)
+#include <windows.h>
+
+#include <psapi.h>
+#else
+#include <sys/mman.h>
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+#endif
+
+namespace chrono = std::chrono;
+
+//
+// Utility to call a cleaner on scope exit.
+//
+
+template <typename F_t> struct Finally_t {
+  F_t f_;
+  Finally_t(F_t &&f) noexcept : f_(f) {}
+  ~Finally_t() noexcept { f_(); }
+};
+
+template <typename F_t> [[nodiscard]] auto finally(F_t &&f) noexcept {
+  return Finally_t(std::move(f));
+}
+
+//
+// Utilities made to display seconds / numbers in a 'cleaner' way (w/ a unit,
+// etc.).
+//
+
+struct SecondsHuman_t {
+  double Value;
+  const char *Unit;
+};
+
+struct NumberHuman_t {
+  double Value;
+  const char *Unit;
+};
+
+template <> struct fmt::formatter<NumberHuman_t> : fmt::formatter<std::string> {
+  template <typename FormatContext>
+  auto format(const NumberHuman_t &Number, FormatContext &Ctx) const
+      -> decltype(Ctx.out()) {
+    return fmt::format_to(Ctx.out(), "{:.1f}{}", Number.Value, Number.Unit);
+  }
+};
+
+template <>
+struct fmt::formatter<SecondsHuman_t> : fmt::formatter<std::string> {
+  template <typename FormatContext>
+  auto format(const SecondsHuman_t &Micro, FormatContext &Ctx) const
+      -> decltype(Ctx.out()) {
+    return fmt::format_to(Ctx.out(), "{:.1f}{}", Micro.Value, Micro.Unit);
+  }
+};
+
+[[nodiscard]] constexpr NumberHuman_t NumberToHuman(const uint64_t N_) {
+  const char *Unit = "";
+  double N = double(N_);
+  const uint64_t K = 1'000;
+  const uint64_t M = K * K;
+  if (N > M) {
+    Unit = "m";
+    N /= M;
+  } else if (N > K) {
+    Unit = "k";
+    N /= K;
+  }
+
+  return {N, Unit};
+}
+
+[[nodiscard]] constexpr SecondsHuman_t
+SecondsToHuman(const chrono::seconds &Seconds) {
+  const char *Unit = "s";
+  double SecondNumber = double(Seconds.count());
+  const double M = 60;
+  const double H = M * 60;
+  const double D = H * 24;
+  if (SecondNumber >= D) {
+    Unit = "d";
+    SecondNumber /= D;
+  } else if (SecondNumber >= H) {
+    Unit = "hr";
+    SecondNumber /= H;
+  } else if (SecondNumber >= M) {
+    Unit = "min";
+    SecondNumber /= M;
+  }
+
+  return {SecondNumber, Unit};
+}
+
+//
+// Utility to calculate how many seconds since a past time point.
+//
+
+[[nodiscard]] inline chrono::seconds
+SecondsSince(const chrono::high_resolution_clock::time_point &Since) {
+  const auto &Now = chrono::high_resolution_clock::now();
+  return chrono::duration_cast<chrono::seconds>(Now - Since);
+}
+
+//
+// Utility to calculate how many nanoseconds since a past time point.
+//
+
+[[nodiscard]] inline uint64_t
+NanosecondsSince(const chrono::steady_clock::time_point &Since) {
+  const auto &Now = chrono::steady_clock::now();
+  return chrono::duration_cast<chrono::nanoseconds>(Now - Since).count();
+}
+
+//
+// Utility to get the peak memory usage of the process in bytes; zero if it
+// isn't available.
+//
+
+[[nodiscard]] inline uint64_t PeakMemoryUsage() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS Counters = {};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters))) {
+    return 0;
+  }
+
+  return Counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+  struct rusage Usage = {};
+  if (getrusage(RUSAGE_SELF, &Usage) != 0) {
+    return 0;
+  }
+
+  return uint64_t(Usage.ru_maxrss) * 1'024;
+#else
+  return 0;
+#endif
+}
+
+//
+// An allocator that gets whole pages straight from the kernel: the memory is
+// page aligned, and once freed it can't be handed out again while the kernel
+// still holds a reference to its pages (think vmsplice).
+//
+
+template <typename T> struct PageAllocator_t {
+  using value_type = T;
+
+  PageAllocator_t() = default;
+  template <typename U> PageAllocator_t(const PageAllocator_t<U> &) {}
+
+  T *allocate(const size_t Count) {
+#if defined(_WIN32)
+    void *Memory = VirtualAlloc(nullptr, Count * sizeof(T),
+                                MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (Memory == nullptr) {
+      throw std::bad_alloc();
+    }
+#else
+    void *Memory = mmap(nullptr, Count * sizeof(T), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Memory == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#endif
+
+    return (T *)Memory;
+  }
+
+  void deallocate(T *Memory, const size_t Count) {
+#if defined(_WIN32)
+    static_cast<void>(Count);
+    VirtualFree(Memory, 0, MEM_RELEASE);
+#else
+    munmap(Memory, Count * sizeof(T));
+#endif
+  }
+
+  template <typename U> bool operator==(const PageAllocator_t<U> &) const {
+    return true;
+  }
+};
+
+//
+// The buffer the output lines are formatted into.
+//
+
+using OutputBuffer_t =
+    fmt::basic_memory_buffer<char, fmt::inline_buffer_size,
+                             PageAllocator_t<char>>;
+
+//
+// Append |String| into |Buffer|, escaped for a JSON string. The strings are
+// almost never in need of escaping, so the runs that are fine are appended in
+// one go.
+//
+
+template <typename Buffer_t>
+void AppendJsonEscaped(Buffer_t &Buffer, const std::string_view String) {
+  const char *Run = String.data();
+  const char *End = Run + String.size();
+  for (const char *Current = Run; Current < End; Current++) {
+    const uint8_t C = uint8_t(*Current);
+    if (C >= 0x20 && C != '"' && C != '\\') {
+      continue;
+    }
+
+    Buffer.append(Run, Current);
+    Run = Current + 1;
+    switch (C) {
+    case '"':
+    case '\\': {
+      Buffer.push_back('\\');
+      Buffer.push_back(char(C));
+      break;
+    }
+
+    case '\n': {
+      Buffer.push_back('\\');
+      Buffer.push_back('n');
+      break;
+    }
+
+    case '\r': {
+      Buffer.push_back('\\');
+      Buffer.push_back('r');
+      break;
+    }
+
+    case '\t': {
+      Buffer.push_back('\\');
+      Buffer.push_back('t');
+      break;
+    }
+
+    default: {
+      fmt::format_to(std::back_inserter(Buffer), "\\u{:04x}", C);
+      break;
+    }
+    }
+  }
+
+  Buffer.append(Run, End);
+}